@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <vector>
+
+// tiny timing helpers for the benchmark executables (no framework, plain console output),
+// and the item types and fragmented grids they measure on
+namespace bench {
+
+// results go through here so the optimizer can't drop the work that produced them
+inline void keep(uint64_t value) {
+    static volatile uint64_t sink = 0;
+    sink = sink + value;
+}
+
+// nanoseconds per call of body, after a short warm-up
+template <typename F>
+double measure(int iterations, F&& body) {
+    for (int i = 0; i < iterations / 10 + 1; ++i) {
+        body();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+inline void report(const std::string& name, double nanoseconds) {
+    std::printf("  %-48s %10.1f ns\n", name.c_str(), nanoseconds);
+}
+
+inline void section(const std::string& title) {
+    std::printf("\n%s\n", title.c_str());
+}
+
+struct ItemKind {
+    inventory::ItemSize size;
+    uint32_t stackLimit = 20;
+};
+
+// one interned item type per kind, in order; ids above the game's own and never handed out twice
+inline std::vector<inventory::ItemHandle> makeItems(std::initializer_list<ItemKind> kinds) {
+    static uint32_t nextId = 9000;
+    std::vector<inventory::ItemHandle> items;
+    for (const ItemKind& kind : kinds) {
+        items.push_back(inventory::ItemTable::intern(inventory::Item(nextId++, "Bench item", kind.size, kind.stackLimit, "")));
+    }
+    return items;
+}
+
+// free space broken up all over the grid instead of sitting in one block at the end: single items
+// dropped at random positions until fillPercent of the cells are taken (random placement can stop
+// short of that on a crowded grid), then removePercent of the stacks taken out again
+// the same seed gives the same layout on any grid with placeItem/removeItem/getAllItems, whatever
+// it holds items by (handles picks them, in the grid's own item type); returns the cells taken
+template <typename Grid, typename Handles>
+int fragment(Grid& grid, const Handles& handles, int fillPercent, int removePercent, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pickX(0, grid.getWidth() - 1);
+    std::uniform_int_distribution<int> pickY(0, grid.getHeight() - 1);
+    std::uniform_int_distribution<size_t> pickItem(0, handles.size() - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    int cells = grid.getWidth() * grid.getHeight();
+    int target = cells * fillPercent / 100;
+    int taken = 0;
+    for (int attempt = 0; attempt < cells * 50 && taken < target; ++attempt) {
+        const auto& item = handles[pickItem(rng)];
+        if (grid.placeItem(item, 1, inventory::GridPosition(pickX(rng), pickY(rng)))) {
+            taken += item->getSize().width * item->getSize().height;
+        }
+    }
+
+    for (const auto& slot : grid.getAllItems()) {
+        if (percent(rng) < removePercent) {
+            taken -= slot.item->getSize().width * slot.item->getSize().height;
+            grid.removeItem(slot.position);
+        }
+    }
+    return taken;
+}
+
+} // namespace bench
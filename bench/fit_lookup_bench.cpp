@@ -0,0 +1,69 @@
+#include "Bench.hpp"
+#include "FixedInventory.hpp"
+#include "DynamicInventory.hpp"
+#include <string>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// what giveItem did before the free-run index: canPlaceItem at every position, row-major
+std::optional<GridPosition> bruteForceFirstFit(const Inventory& inventory, const Item& item) {
+    for (int y = 0; y < inventory.getHeight(); ++y) {
+        for (int x = 0; x < inventory.getWidth(); ++x) {
+            if (inventory.canPlaceItem(item, GridPosition(x, y))) {
+                return GridPosition(x, y);
+            }
+        }
+    }
+    return std::nullopt;
+}
+
+uint64_t encode(const std::optional<GridPosition>& pos) {
+    return pos ? static_cast<uint64_t>(pos->y * 64 + pos->x + 1) : 0;
+}
+
+void run(const std::string& name, Inventory& grid, const std::vector<ItemHandle>& items) {
+    const Item& square = *items[3];
+    const Item& tall = *items[5];
+
+    for (int percent : {0, 25, 50, 70, 85}) {
+        grid.clear();
+        int taken = bench::fragment(grid, items, percent, 0, 11 + percent);
+        grid.takeDelta();
+        bench::section(name + ", " + std::to_string(taken * 100 / (grid.getWidth() * grid.getHeight())) +
+                       "% of the cells taken (" + std::to_string(grid.getItemCount()) + " items)");
+
+        bench::report("brute force first fit 2x2", bench::measure(100000, [&]() {
+            bench::keep(encode(bruteForceFirstFit(grid, square)));
+        }));
+        bench::report("findFirstFit 2x2", bench::measure(200000, [&]() {
+            bench::keep(encode(grid.findFirstFit(square.getSize())));
+        }));
+        bench::report("brute force first fit 2x3", bench::measure(100000, [&]() {
+            bench::keep(encode(bruteForceFirstFit(grid, tall)));
+        }));
+        bench::report("findFirstFit 2x3", bench::measure(200000, [&]() {
+            bench::keep(encode(grid.findFirstFit(tall.getSize())));
+        }));
+        bench::report("findAllFits 2x2", bench::measure(50000, [&]() {
+            bench::keep(grid.findAllFits(square.getSize()).size());
+        }));
+    }
+}
+
+} // namespace
+
+// placement lookups on a 12x12 stash as it fills up and fragments: findFirstFit should cost
+// about the same at every fill level, the brute-force scan it replaced grows with the fill
+int main() {
+    std::vector<ItemHandle> items = bench::makeItems({{{1, 1}}, {{1, 2}}, {{2, 1}}, {{2, 2}}, {{1, 3}}, {{2, 3}}});
+
+    StashInventoryGrid fixedStash;
+    run("FixedInventory<12, 12>", fixedStash, items);
+
+    DynamicInventory dynamicStash(12, 12);
+    run("DynamicInventory 12x12", dynamicStash, items);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include "Bench.hpp"
+#include "FixedInventory.hpp"
+#include "DynamicInventory.hpp"
+#include <string>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+template <typename Grid>
+void run(const std::string& name, Grid& grid, const std::vector<ItemHandle>& items) {
+    bench::fragment(grid, items, 70, 33, 5);  // same fragmented layout for both grids, a third taken out again
+    bench::section(name + " (" + std::to_string(grid.getItemCount()) + " items after fragmenting)");
+
+    const Item& square = *items[3];
+    bench::report("canPlaceItem 2x2, every position", bench::measure(20000, [&]() {
+        uint64_t fits = 0;
+        for (int y = 0; y < grid.getHeight(); ++y) {
+            for (int x = 0; x < grid.getWidth(); ++x) {
+                fits += grid.canPlaceItem(square, GridPosition(x, y));
+            }
+        }
+        bench::keep(fits);
+    }));
+
+    for (int i : {0, 3, 5}) {
+        ItemSize size = items[i]->getSize();
+        std::string label = std::to_string(size.width) + "x" + std::to_string(size.height);
+        bench::report("findFirstFit " + label, bench::measure(200000, [&]() {
+            std::optional<GridPosition> pos = grid.findFirstFit(size);
+            bench::keep(pos ? static_cast<uint64_t>(pos->y * 64 + pos->x) : 0);
+        }));
+        bench::report("findAllFits " + label, bench::measure(50000, [&]() {
+            bench::keep(grid.findAllFits(size).size());
+        }));
+    }
+
+    // what a move does to the grid: find room, place, take it out again
+    ItemHandle moved = items[4];
+    bench::report("findFirstFit + placeItem + removeItem 2x3", bench::measure(200000, [&]() {
+        std::optional<GridPosition> pos = grid.findFirstFit(moved->getSize());
+        if (pos && grid.placeItem(moved, 1, *pos)) {
+            bench::keep(grid.removeItem(*pos)->stackCount);
+        }
+        grid.takeDelta();
+    }));
+}
+
+} // namespace
+
+// FixedInventory (what Inventory::create hands out for 12x5 and 12x12) against DynamicInventory
+// in the same shapes, on the same fragmented layouts
+int main() {
+    std::vector<ItemHandle> items = bench::makeItems({{{1, 1}}, {{1, 1}}, {{1, 2}}, {{2, 2}}, {{2, 3}}, {{2, 4}}});
+
+    PersonalInventoryGrid fixedPersonal;
+    DynamicInventory dynamicPersonal(12, 5);
+    run("FixedInventory<12, 5>", fixedPersonal, items);
+    run("DynamicInventory 12x5", dynamicPersonal, items);
+
+    StashInventoryGrid fixedStash;
+    DynamicInventory dynamicStash(12, 12);
+    run("FixedInventory<12, 12>", fixedStash, items);
+    run("DynamicInventory 12x12", dynamicStash, items);
+
+    bench::section("footprint");
+    std::printf("  %-48s %10zu bytes\n", "sizeof(FixedInventory<12, 12>)", sizeof(StashInventoryGrid));
+    std::printf("  %-48s %10zu bytes (+ heap)\n", "sizeof(DynamicInventory)", sizeof(DynamicInventory));
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "Bench.hpp"
+#include "FixedInventory.hpp"
+#include "DynamicInventory.hpp"
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace inventory;
+
+// heap bytes currently allocated, every allocation of this executable goes through here
+namespace {
+size_t liveHeapBytes = 0;
+}
+
+void* operator new(size_t size) {
+    // the size rides in front of the block so delete can take it back off the count
+    void* block = std::malloc(size + alignof(std::max_align_t));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    liveHeapBytes += size;
+    return static_cast<char*>(block) + alignof(std::max_align_t);
+}
+
+void operator delete(void* pointer) noexcept {
+    if (pointer) {
+        void* block = static_cast<char*>(pointer) - alignof(std::max_align_t);
+        liveHeapBytes -= *static_cast<size_t*>(block);
+        std::free(block);
+    }
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+namespace {
+
+// the grid as it was stored before the struct-of-arrays layout: one vector per row, and per cell
+// a shared_ptr to the item, a count, the cell's own position and a covered-by-another-item flag
+class LegacyInventory {
+public:
+    struct Cell {
+        std::shared_ptr<Item> item;
+        uint32_t stackCount = 0;
+        GridPosition position;
+        bool isOccupied = false;
+
+        bool isEmpty() const { return item == nullptr || stackCount == 0; }
+    };
+
+    LegacyInventory(int width, int height) : width_(width), height_(height) {
+        grid_.resize(height);
+        for (int y = 0; y < height; ++y) {
+            grid_[y].resize(width);
+            for (int x = 0; x < width; ++x) {
+                grid_[y][x].position = GridPosition(x, y);
+            }
+        }
+    }
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+
+    bool canPlaceItem(const Item& item, GridPosition pos) const {
+        ItemSize size = item.getSize();
+        for (int y = pos.y; y < pos.y + size.height; ++y) {
+            for (int x = pos.x; x < pos.x + size.width; ++x) {
+                if (x < 0 || x >= width_ || y < 0 || y >= height_) {
+                    return false;
+                }
+                if (!grid_[y][x].isEmpty() || grid_[y][x].isOccupied) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool placeItem(const std::shared_ptr<Item>& item, uint32_t count, GridPosition pos) {
+        if (!item || count == 0 || count > item->getStackLimit() || !canPlaceItem(*item, pos)) {
+            return false;
+        }
+        ItemSize size = item->getSize();
+        for (int y = pos.y; y < pos.y + size.height; ++y) {
+            for (int x = pos.x; x < pos.x + size.width; ++x) {
+                bool origin = x == pos.x && y == pos.y;
+                grid_[y][x].item = origin ? item : nullptr;
+                grid_[y][x].stackCount = origin ? count : 0;
+                grid_[y][x].isOccupied = !origin;
+            }
+        }
+        return true;
+    }
+
+    std::optional<Cell> removeItem(GridPosition pos) {
+        if (pos.x < 0 || pos.x >= width_ || pos.y < 0 || pos.y >= height_ || grid_[pos.y][pos.x].isEmpty()) {
+            return std::nullopt;
+        }
+        Cell result = grid_[pos.y][pos.x];
+        ItemSize size = result.item->getSize();
+        for (int y = pos.y; y < pos.y + size.height; ++y) {
+            for (int x = pos.x; x < pos.x + size.width; ++x) {
+                grid_[y][x].item = nullptr;
+                grid_[y][x].stackCount = 0;
+                grid_[y][x].isOccupied = false;
+            }
+        }
+        return result;
+    }
+
+    std::vector<Cell> getAllItems() const {
+        std::vector<Cell> items;
+        for (const auto& row : grid_) {
+            for (const auto& cell : row) {
+                if (!cell.isEmpty()) {
+                    items.push_back(cell);
+                }
+            }
+        }
+        return items;
+    }
+
+private:
+    int width_;
+    int height_;
+    std::vector<std::vector<Cell>> grid_;
+};
+
+struct Items {
+    std::vector<ItemHandle> handles;           // what Inventory stores
+    std::vector<std::shared_ptr<Item>> shared; // what the legacy grid stored
+};
+
+Items makeItems() {
+    Items items;
+    items.handles = bench::makeItems({{{1, 1}}, {{1, 1}}, {{1, 2}}, {{2, 2}}, {{2, 3}}, {{2, 4}}});
+    for (const ItemHandle& handle : items.handles) {
+        items.shared.push_back(std::make_shared<Item>(*handle));
+    }
+    return items;
+}
+
+template <typename Grid, typename Handles>
+void run(const std::string& name, Grid& grid, const Handles& handles, size_t emptyHeapBytes) {
+    bench::fragment(grid, handles, 70, 0, 3);  // the same seed, item i goes to the same spot in every layout
+    bench::section(name + " 12x12 (" + std::to_string(grid.getAllItems().size()) + " items)");
+    std::printf("  %-48s %10zu bytes\n", "footprint, empty (object + heap)", emptyHeapBytes);
+
+    const Item& square = *handles[3];
+    bench::report("canPlaceItem 2x2, every position", bench::measure(20000, [&]() {
+        uint64_t fits = 0;
+        for (int y = 0; y < grid.getHeight(); ++y) {
+            for (int x = 0; x < grid.getWidth(); ++x) {
+                fits += grid.canPlaceItem(square, GridPosition(x, y));
+            }
+        }
+        bench::keep(fits);
+    }));
+
+    auto removed = grid.removeItem(grid.getAllItems().front().position);
+    GridPosition freed = removed->position;
+    auto item = handles[0];
+    bench::report("placeItem + removeItem 1x1", bench::measure(500000, [&]() {
+        grid.placeItem(item, 1, freed);
+        bench::keep(grid.removeItem(freed)->stackCount);
+    }));
+
+    bench::report("getAllItems", bench::measure(50000, [&]() {
+        bench::keep(grid.getAllItems().size());
+    }));
+}
+
+// heap bytes one inventory holds right after construction, plus the object itself
+template <typename Make>
+size_t footprint(Make make) {
+    size_t before = liveHeapBytes;
+    auto inventory = make();
+    size_t bytes = liveHeapBytes - before;
+    return bytes;
+}
+
+} // namespace
+
+// the struct-of-arrays grids against the old vector-of-rows layout on the same 12x12 fill:
+// speed of the placement primitives and how much memory one empty stash takes
+int main() {
+    Items items = makeItems();
+
+    size_t legacyBytes = footprint([]() { return std::make_unique<LegacyInventory>(12, 12); });
+    size_t dynamicBytes = footprint([]() { return std::make_unique<DynamicInventory>(12, 12); });
+    size_t fixedBytes = footprint([]() { return std::make_unique<StashInventoryGrid>(); });
+
+    LegacyInventory legacy(12, 12);
+    run("vector<vector<cell>> (old layout)", legacy, items.shared, legacyBytes);
+
+    DynamicInventory dynamic(12, 12);
+    run("DynamicInventory", dynamic, items.handles, dynamicBytes);
+
+    StashInventoryGrid fixed;
+    run("FixedInventory (what stashes use)", fixed, items.handles, fixedBytes);
+    return 0;
+}
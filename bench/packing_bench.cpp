@@ -0,0 +1,121 @@
+#include "Bench.hpp"
+#include "FixedInventory.hpp"
+#include "InventoryPacker.hpp"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// a stash the way players leave it: items dropped wherever there was room, partial stacks of the
+// same item spread over several cells, then some of it taken out again
+void scatter(Inventory& stash, const std::vector<ItemHandle>& items, std::mt19937& rng) {
+    stash.clear();
+    std::uniform_int_distribution<int> pickX(0, stash.getWidth() - 1);
+    std::uniform_int_distribution<int> pickY(0, stash.getHeight() - 1);
+    std::uniform_int_distribution<size_t> pickItem(0, items.size() - 1);
+    std::uniform_int_distribution<int> percent(0, 99);
+
+    int attempts = std::uniform_int_distribution<int>(40, 400)(rng);
+    for (int i = 0; i < attempts; ++i) {
+        const ItemHandle& item = items[pickItem(rng)];
+        uint32_t limit = item->getStackLimit();
+        uint32_t count = std::uniform_int_distribution<uint32_t>(1, limit)(rng);
+        stash.placeItem(item, count, GridPosition(pickX(rng), pickY(rng)));
+    }
+    for (const InventorySlot& slot : stash.getAllItems()) {
+        if (percent(rng) < 20) {
+            stash.removeItem(slot.position);
+        }
+    }
+    stash.takeDelta();
+}
+
+struct Shape {
+    size_t stacks = 0;
+    int cellsTaken = 0;
+    int rowsUsed = 0;       // rows down to the lowest item
+    size_t bigFits = 0;     // positions a 2x4 (the biggest item) could still go
+};
+
+Shape measureShape(const Inventory& stash) {
+    Shape shape;
+    stash.forEachItem([&shape](const InventorySlot& slot) {
+        ItemSize size = slot.item->getSize();
+        ++shape.stacks;
+        shape.cellsTaken += size.width * size.height;
+        shape.rowsUsed = std::max(shape.rowsUsed, slot.position.y + size.height);
+    });
+    shape.bigFits = stash.findAllFits(ItemSize(2, 4)).size();
+    return shape;
+}
+
+} // namespace
+
+// SORT_INVENTORY's packing pass on random fragmented 12x12 stashes: how long a plan takes, how
+// often everything fits back in, and how much tidier the stash is afterwards
+int main() {
+    std::vector<ItemHandle> items = bench::makeItems({{{1, 1}, 20}, {{1, 1}, 20}, {{1, 1}, 1}, {{1, 2}, 5}, {{2, 1}, 1},
+                                                      {{2, 2}, 1}, {{1, 3}, 1}, {{2, 3}, 1}, {{2, 4}, 1}});
+    std::mt19937 rng(13);
+    const int stashes = 2000;
+
+    StashInventoryGrid stash;
+    StashInventoryGrid sorted;
+    std::vector<InventoryPacker::Placement> layout;
+
+    int packed = 0;
+    std::vector<double> times;
+    double stacksBefore = 0, stacksAfter = 0;
+    double rowsBefore = 0, rowsAfter = 0;
+    double bigFitsBefore = 0, bigFitsAfter = 0;
+    double density = 0;
+
+    for (int i = 0; i < stashes; ++i) {
+        scatter(stash, items, rng);
+
+        auto start = std::chrono::steady_clock::now();
+        bool fits = InventoryPacker::pack(stash, layout);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        times.push_back(ns);
+        if (!fits) {
+            continue;
+        }
+
+        ++packed;
+        sorted.clear();
+        for (const InventoryPacker::Placement& placement : layout) {
+            sorted.placeItem(placement.item, placement.count, placement.position, placement.instanceId);
+        }
+        sorted.takeDelta();
+
+        Shape before = measureShape(stash);
+        Shape after = measureShape(sorted);
+        stacksBefore += before.stacks;
+        stacksAfter += after.stacks;
+        rowsBefore += before.rowsUsed;
+        rowsAfter += after.rowsUsed;
+        bigFitsBefore += before.bigFits;
+        bigFitsAfter += after.bigFits;
+        if (after.rowsUsed > 0) {
+            density += static_cast<double>(after.cellsTaken) / (after.rowsUsed * sorted.getWidth());
+        }
+    }
+
+    bench::section("InventoryPacker::pack on " + std::to_string(stashes) + " random 12x12 stashes");
+    std::sort(times.begin(), times.end());
+    bench::report("pack, median", times[times.size() / 2]);
+    bench::report("pack, 99th percentile", times[times.size() * 99 / 100]);
+
+    bench::section("quality (mean over the " + std::to_string(packed) + " stashes that packed)");
+    std::printf("  %-48s %9.1f %%\n", "stashes packed", 100.0 * packed / stashes);
+    std::printf("  %-48s %6.1f -> %.1f\n", "stacks", stacksBefore / packed, stacksAfter / packed);
+    std::printf("  %-48s %6.1f -> %.1f\n", "rows down to the lowest item", rowsBefore / packed, rowsAfter / packed);
+    std::printf("  %-48s %6.1f -> %.1f\n", "positions a 2x4 still fits", bigFitsBefore / packed, bigFitsAfter / packed);
+    std::printf("  %-48s %9.1f %%\n", "cells taken within the rows used", 100.0 * density / packed);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "Bench.hpp"
+#include "FixedInventory.hpp"
+#include "PersonalInventoryTable.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// the map InventoryManager had before PersonalInventoryTable: one unordered_map behind one mutex,
+// looked up by the plain username (hashed again on every lookup)
+class SingleMutexTable {
+public:
+    Inventory* find(const std::string& username) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = inventories_.find(username);
+        return it != inventories_.end() ? it->second.get() : nullptr;
+    }
+
+    void insert(const std::string& username, std::unique_ptr<Inventory> inventory) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inventories_[username] = std::move(inventory);
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::unique_ptr<Inventory>> inventories_;
+};
+
+// lookups spread over threadCount threads, every thread picking random players;
+// returns the wall time per lookup over all of them
+template <typename Lookup>
+double run(int threadCount, int lookupsPerThread, size_t players, Lookup lookup) {
+    std::atomic<int> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            std::mt19937 rng(static_cast<uint32_t>(t) + 1);
+            std::uniform_int_distribution<size_t> pick(0, players - 1);
+            ++ready;
+            while (!go) {
+                std::this_thread::yield();
+            }
+            uint64_t found = 0;
+            for (int i = 0; i < lookupsPerThread; ++i) {
+                found += lookup(pick(rng)) ? 1 : 0;
+            }
+            bench::keep(found);
+        });
+    }
+
+    while (ready < threadCount) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    go = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return elapsed / (static_cast<double>(threadCount) * lookupsPerThread);
+}
+
+} // namespace
+
+// personal inventory lookups at 100k logged-in players from several threads at once (what the
+// reactors and workers do several times per move): the sharded table against the single mutex
+// the reported time is wall time per lookup, so on more cores than threads it should drop as
+// threads are added, and only the single mutex should keep it from doing so
+int main() {
+    const size_t players = 100000;
+    const int lookupsPerThread = 1000000;
+
+    std::vector<std::string> names;
+    std::vector<PersonalKey> keys;
+    for (size_t i = 0; i < players; ++i) {
+        names.push_back("player" + std::to_string(i));
+        keys.emplace_back(names.back());
+    }
+
+    SingleMutexTable single;
+    PersonalInventoryTable sharded;
+    for (size_t i = 0; i < players; ++i) {
+        single.insert(names[i], std::make_unique<PersonalInventoryGrid>());
+        sharded.findOrCreate(keys[i], []() { return std::make_unique<PersonalInventoryGrid>(); });
+    }
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    bench::section("personal inventory lookup, " + std::to_string(players) + " players, " +
+                   std::to_string(cores) + " hardware threads");
+    for (int threads : {1, 2, 4, 8}) {
+        std::string suffix = ", " + std::to_string(threads) + (threads == 1 ? " thread" : " threads");
+        bench::report("single mutex, by username" + suffix, run(threads, lookupsPerThread, players, [&](size_t i) {
+            return single.find(names[i]);
+        }));
+        bench::report("PersonalInventoryTable, by PersonalKey" + suffix, run(threads, lookupsPerThread, players, [&](size_t i) {
+            return sharded.find(keys[i]);
+        }));
+    }
+    return 0;
+}
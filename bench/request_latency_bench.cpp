@@ -0,0 +1,136 @@
+#include "Bench.hpp"
+#include "TestServer.hpp"
+#include "ItemRegistry.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+const int FILLER_STACKS = 58;  // all of a personal inventory but two cells
+
+// a neighbor with a full inventory asking for its full sync and a sort over and over, in bursts,
+// reading every answer so it's never dropped as a slow reader
+void spam(test::TestClient& client, const std::atomic<bool>& stop) {
+    const int burst = 32;
+    std::vector<uint8_t> requests;
+    for (int i = 0; i < burst; ++i) {
+        NetworkMessage msg(i % 2 == 0 ? MessageType::SYNC_REQUEST : MessageType::SORT_INVENTORY);
+        msg.payload = {0};
+        std::vector<uint8_t> frame = msg.serialize();
+        requests.insert(requests.end(), frame.begin(), frame.end());
+    }
+
+    while (!stop) {
+        if (!client.sendBytes(requests)) {
+            return;
+        }
+        for (int syncs = 0; syncs < burst / 2;) {
+            std::optional<NetworkMessage> msg = client.receive(5000);
+            if (!msg) {
+                return;
+            }
+            syncs += msg->type == MessageType::INVENTORY_FULL_SYNC ? 1 : 0;
+        }
+    }
+}
+
+// round trips of one player's moves (send to OPERATION_RESULT), one at a time, in microseconds
+std::vector<double> probe(test::TestClient& client, int moves) {
+    std::vector<double> latencies;
+    for (int i = 0; i < moves; ++i) {
+        uint8_t from = static_cast<uint8_t>(i % 2);
+        auto start = std::chrono::steady_clock::now();
+        client.send(MessageType::MOVE_ITEM_REQUEST, {0, from, 0, 0, static_cast<uint8_t>(1 - from), 0});
+        if (!client.receiveType(MessageType::OPERATION_RESULT, 5000)) {
+            break;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    return latencies;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+void runScenario(int neighborCount, int moves) {
+    ServerConfig config;
+    config.reactorThreads = 1;  // the probe shares its reactor with every neighbor
+    config.workerThreads = 2;
+    config.heartbeatIntervalMs = 0;
+
+    int port = 0;
+    std::unique_ptr<Server> server = test::startServer(config, port);
+    if (!server) {
+        std::printf("  no port to listen on\n");
+        return;
+    }
+
+    std::vector<std::unique_ptr<test::TestClient>> neighbors;
+    for (int n = 0; n < neighborCount; ++n) {
+        std::string name = "neighbor" + std::to_string(n);
+        auto client = std::make_unique<test::TestClient>(port);
+        client->login(name);
+        for (int i = 0; i < FILLER_STACKS; ++i) {
+            server->giveItem(name, 12, 1);  // 1x1, one per stack: as many records as the grid holds
+        }
+        neighbors.push_back(std::move(client));
+    }
+
+    test::TestClient player(port);
+    player.login("player");
+    server->giveItem("player", 1, 5);
+    player.receiveType(MessageType::INVENTORY_UPDATE);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> threads;
+    for (auto& neighbor : neighbors) {
+        threads.emplace_back([&stop, c = neighbor.get()]() { spam(*c, stop); });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));  // let the load build up
+
+    std::vector<double> latencies = probe(player, moves);
+    stop = true;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    server->stop();
+
+    std::string label = std::to_string(neighborCount) + (neighborCount == 1 ? " neighbor" : " neighbors");
+    std::printf("  %-20s %6zu moves   p50 %8.1f us   p99 %8.1f us   max %8.1f us\n", label.c_str(),
+                latencies.size(), percentile(latencies, 0.50), percentile(latencies, 0.99),
+                percentile(latencies, 1.0));
+}
+
+} // namespace
+
+// what one player's moves take end to end while players next to it on the same reactor keep the
+// server busy with full syncs and sorts of full inventories; those run on the worker pool, so the
+// reactor keeps reading the player's socket and the tail should stay close to the idle one
+int main() {
+    const int moves = 2000;
+
+    ItemRegistry::getInstance().initialize();
+
+    // the server logs every request, only the results go to the console
+    std::cout.setstate(std::ios_base::badbit);
+    std::cerr.setstate(std::ios_base::badbit);
+
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    bench::section("move round trip, 1 reactor, 2 workers, " + std::to_string(cores) + " hardware threads");
+    for (int neighbors : {0, 4, 16}) {
+        runScenario(neighbors, moves);
+    }
+    return 0;
+}
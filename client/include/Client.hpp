@@ -29,9 +29,21 @@ public:
     void requestMoveItem(InventoryType sourceInv, int sourceX, int sourceY,
                         InventoryType destInv, int destX, int destY);
     
+    // Move a stack by its instance id, wherever the server has it now
+    void requestMoveInstance(uint64_t instanceId, InventoryType destInv, int destX, int destY);
+    
     // Send stack split request to server
     void requestSplitStack(InventoryType invType, int x, int y, int amount, int destX, int destY);
     
+    // Ask the server to merge stacks and compact one inventory
+    void requestSortInventory(InventoryType invType);
+    
+    // Ask for a full sync of one inventory (after missing a delta)
+    void requestSync(InventoryType invType);
+    
+    // Watch a shared stash (0-2), the previously watched one stops receiving updates
+    void subscribeStash(int stashIndex);
+    
     bool sendMessage(const NetworkMessage& msg);
     bool receiveMessage(NetworkMessage& msg);
     
@@ -44,12 +56,18 @@ private:
     std::shared_ptr<ClientInventory> personalInventory_;
     std::shared_ptr<ClientInventory> sharedStashes_[3];  // 3 shared stashes (12x12 each)
     mutable std::mutex inventoryMutex_;
+    std::mutex sendMutex_;  // the listener thread sends resync requests too
+    int subscribedStash_;
     
     std::vector<uint8_t> receiveBuffer_;  // Buffer for partial messages
     
+    uint32_t viewVersion(InventoryType invType) const;
+    static void appendUint32(std::vector<uint8_t>& data, uint32_t value);
+    
     void messageListener();
     void handleInventorySync(const NetworkMessage& msg);
     void handleSharedStashSync(const NetworkMessage& msg);
+    void handleInventoryUpdate(const NetworkMessage& msg);
 };
 
 } // namespace inventory
@@ -3,14 +3,23 @@
 #include "Item.hpp"
 #include "Inventory.hpp"
 #include <memory>
+#include <optional>
 #include <vector>
+#include <mutex>
 
 namespace inventory {
 
 // client-side representation of inventory
-// storing the items received from server INVENTORY_FULL_SYNC messages
+// storing the items received from server INVENTORY_FULL_SYNC messages, kept current by INVENTORY_UPDATE deltas
 class ClientInventory {
 public:
+    enum class DeltaResult {
+        APPLIED,
+        STALE,    // already covered by what we have, ignored
+        GAP,      // we missed changes, needs a full sync
+        INVALID
+    };
+    
     ClientInventory(int width, int height);
     
     void clear();
@@ -18,17 +27,40 @@ public:
     // update from server data
     bool updateFromSyncData(const std::vector<uint8_t>& data);
     
-    // query inventory state
-    const InventorySlot* getSlot(int x, int y) const;
+    // apply an INVENTORY_UPDATE payload starting at offset (right after the inventory type byte)
+    DeltaResult applyDelta(const std::vector<uint8_t>& data, size_t offset);
+    
+    // the server version this view shows, sent along with requests so stale ones get rejected
+    uint32_t getVersion() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return version_;
+    }
+    
+    // query inventory state (copies, the listener thread may replace items_ right after)
+    std::optional<InventorySlot> getSlot(int x, int y) const;
     std::vector<InventorySlot> getAllItems() const;
     
+    // visit every item in place, without copying (the render loop runs this every frame)
+    // holds the inventory's lock while visiting, so visit must not call back into this inventory
+    template <typename F>
+    void forEachItem(F&& visit) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& slot : items_) {
+            visit(slot);
+        }
+    }
+    
     int getWidth() const { return width_; }
     int getHeight() const { return height_; }
     
 private:
     int width_;
     int height_;
+    uint32_t version_;
     std::vector<InventorySlot> items_;
+    mutable std::mutex mutex_;  // the listener thread applies syncs while the render thread draws
+    
+    static bool parseItemRecord(const std::vector<uint8_t>& data, size_t& offset, InventorySlot& slot);
 };
 
 } // namespace inventory
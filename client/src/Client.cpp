@@ -10,7 +10,14 @@
 
 namespace inventory {
 
-Client::Client() : socket_(-1), connected_(false) {
+namespace {
+
+// InventoryManager::OperationResult::STALE_VIEW on the server
+const uint8_t STALE_VIEW_RESULT = 7;
+
+} // namespace
+
+Client::Client() : socket_(-1), connected_(false), subscribedStash_(-1) {
     // Personal inventory: 12 columns x 5 rows
     personalInventory_ = std::make_shared<ClientInventory>(12, 5);
     
@@ -160,6 +167,21 @@ std::shared_ptr<ClientInventory> Client::getSharedStash(int stashIndex) const {
     return sharedStashes_[stashIndex];
 }
 
+uint32_t Client::viewVersion(InventoryType invType) const {
+    int index = static_cast<int>(invType);
+    if (index == 0) {
+        return personalInventory_->getVersion();
+    }
+    return sharedStashes_[index - 1]->getVersion();
+}
+
+void Client::appendUint32(std::vector<uint8_t>& data, uint32_t value) {
+    data.push_back((value >> 24) & 0xFF);
+    data.push_back((value >> 16) & 0xFF);
+    data.push_back((value >> 8) & 0xFF);
+    data.push_back(value & 0xFF);
+}
+
 void Client::requestMoveItem(InventoryType sourceInv, int sourceX, int sourceY,
                              InventoryType destInv, int destX, int destY) {
     if (!connected_) {
@@ -170,12 +192,15 @@ void Client::requestMoveItem(InventoryType sourceInv, int sourceX, int sourceY,
     NetworkMessage msg(MessageType::MOVE_ITEM_REQUEST);
     
     // Payload format: [sourceInv:1][sourceX:1][sourceY:1][destInv:1][destX:1][destY:1]
+    //                 [sourceVersion:4][destVersion:4]
     msg.payload.push_back(static_cast<uint8_t>(sourceInv));
     msg.payload.push_back(static_cast<uint8_t>(sourceX));
     msg.payload.push_back(static_cast<uint8_t>(sourceY));
     msg.payload.push_back(static_cast<uint8_t>(destInv));
     msg.payload.push_back(static_cast<uint8_t>(destX));
     msg.payload.push_back(static_cast<uint8_t>(destY));
+    appendUint32(msg.payload, viewVersion(sourceInv));
+    appendUint32(msg.payload, viewVersion(destInv));
     
     if (!sendMessage(msg)) {
         std::cerr << "Failed to send move item request" << std::endl;
@@ -185,6 +210,28 @@ void Client::requestMoveItem(InventoryType sourceInv, int sourceX, int sourceY,
     }
 }
 
+void Client::requestMoveInstance(uint64_t instanceId, InventoryType destInv, int destX, int destY) {
+    if (!connected_) {
+        std::cerr << "Cannot send move request: not connected" << std::endl;
+        return;
+    }
+    
+    NetworkMessage msg(MessageType::MOVE_INSTANCE_REQUEST);
+    
+    // Payload format: [instanceId:8][destInv:1][destX:1][destY:1][destVersion:4]
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        msg.payload.push_back(static_cast<uint8_t>(instanceId >> shift));
+    }
+    msg.payload.push_back(static_cast<uint8_t>(destInv));
+    msg.payload.push_back(static_cast<uint8_t>(destX));
+    msg.payload.push_back(static_cast<uint8_t>(destY));
+    appendUint32(msg.payload, viewVersion(destInv));
+    
+    if (!sendMessage(msg)) {
+        std::cerr << "Failed to send move instance request" << std::endl;
+    }
+}
+
 void Client::requestSplitStack(InventoryType invType, int x, int y, int amount, int destX, int destY) {
     if (!connected_) {
         std::cerr << "Cannot send split stack request: not connected" << std::endl;
@@ -193,7 +240,7 @@ void Client::requestSplitStack(InventoryType invType, int x, int y, int amount,
     
     NetworkMessage msg(MessageType::SPLIT_STACK_REQUEST);
     
-    // Payload format: [invType:1][sourceX:1][sourceY:1][amount:4][destX:1][destY:1]
+    // Payload format: [invType:1][sourceX:1][sourceY:1][amount:4][destX:1][destY:1][version:4]
     msg.payload.push_back(static_cast<uint8_t>(invType));
     msg.payload.push_back(static_cast<uint8_t>(x));
     msg.payload.push_back(static_cast<uint8_t>(y));
@@ -206,6 +253,7 @@ void Client::requestSplitStack(InventoryType invType, int x, int y, int amount,
     
     msg.payload.push_back(static_cast<uint8_t>(destX));
     msg.payload.push_back(static_cast<uint8_t>(destY));
+    appendUint32(msg.payload, viewVersion(invType));
     
     if (!sendMessage(msg)) {
         std::cerr << "Failed to send split stack request" << std::endl;
@@ -215,11 +263,63 @@ void Client::requestSplitStack(InventoryType invType, int x, int y, int amount,
     }
 }
 
+void Client::requestSortInventory(InventoryType invType) {
+    if (!connected_) {
+        std::cerr << "Cannot send sort request: not connected" << std::endl;
+        return;
+    }
+    
+    NetworkMessage msg(MessageType::SORT_INVENTORY);
+    
+    // Payload format: [invType:1]
+    msg.payload.push_back(static_cast<uint8_t>(invType));
+    
+    if (!sendMessage(msg)) {
+        std::cerr << "Failed to send sort request" << std::endl;
+    }
+}
+
+void Client::requestSync(InventoryType invType) {
+    NetworkMessage msg(MessageType::SYNC_REQUEST);
+    
+    // Payload format: [invType:1]
+    msg.payload.push_back(static_cast<uint8_t>(invType));
+    
+    if (!sendMessage(msg)) {
+        std::cerr << "Failed to send sync request" << std::endl;
+    }
+}
+
+void Client::subscribeStash(int stashIndex) {
+    if (!connected_ || stashIndex < 0 || stashIndex > 2 || stashIndex == subscribedStash_) {
+        return;
+    }
+    
+    // Payload format: [stashIndex:1]
+    if (subscribedStash_ >= 0) {
+        NetworkMessage unsubscribe(MessageType::UNSUBSCRIBE_STASH);
+        unsubscribe.payload.push_back(static_cast<uint8_t>(subscribedStash_));
+        sendMessage(unsubscribe);
+    }
+    
+    NetworkMessage subscribe(MessageType::SUBSCRIBE_STASH);
+    subscribe.payload.push_back(static_cast<uint8_t>(stashIndex));
+    if (!sendMessage(subscribe)) {
+        std::cerr << "Failed to send stash subscription" << std::endl;
+        return;
+    }
+    
+    // the server answers with a full SHARED_STASH_UPDATE for the new stash
+    subscribedStash_ = stashIndex;
+}
+
 bool Client::sendMessage(const NetworkMessage& msg) {
     if (socket_ < 0) {
         return false;
     }
     
+    std::lock_guard<std::mutex> lock(sendMutex_);
+    
     std::vector<uint8_t> data = msg.serialize();
     int bytesSent = send(socket_, data.data(), data.size(), 0);
     return bytesSent == static_cast<int>(data.size());
@@ -323,7 +423,11 @@ void Client::messageListener() {
                 handleInventorySync(msg);
             }
             else if (msg.type == MessageType::OPERATION_RESULT) {
-                if (msg.payload.size() >= 2) {
+                if (msg.payload.size() == 1 && msg.payload[0] == STALE_VIEW_RESULT) {
+                    // not a real failure, the update that moved things under us is on its way
+                    std::cout << "Operation rejected: inventory changed since it was drawn" << std::endl;
+                }
+                else if (msg.payload.size() >= 2) {
                     uint8_t resultCode = msg.payload[0];
                     uint8_t messageLen = msg.payload[1];
                     
@@ -343,6 +447,13 @@ void Client::messageListener() {
             else if (msg.type == MessageType::SHARED_STASH_UPDATE) {
                 handleSharedStashSync(msg);
             }
+            else if (msg.type == MessageType::INVENTORY_UPDATE) {
+                handleInventoryUpdate(msg);
+            }
+            else if (msg.type == MessageType::HEARTBEAT) {
+                // server checks if we're still there, answer so the session isn't reaped
+                sendMessage(NetworkMessage(MessageType::HEARTBEAT));
+            }
         }
         
         // trying to avoid busy waitin
@@ -381,4 +492,35 @@ void Client::handleSharedStashSync(const NetworkMessage& msg) {
     }
 }
 
+void Client::handleInventoryUpdate(const NetworkMessage& msg) {
+    // Payload format: [invType:1byte][delta...]
+    if (msg.payload.empty()) {
+        std::cerr << "Empty inventory update payload" << std::endl;
+        return;
+    }
+    
+    uint8_t invType = msg.payload[0];
+    std::shared_ptr<ClientInventory> target;
+    if (invType == static_cast<uint8_t>(InventoryType::PERSONAL)) {
+        target = personalInventory_;
+    } else if (invType >= 1 && invType <= 3) {
+        target = sharedStashes_[invType - 1];
+    } else {
+        std::cerr << "Invalid inventory type in update: " << (int)invType << std::endl;
+        return;
+    }
+    
+    ClientInventory::DeltaResult result;
+    {
+        std::lock_guard<std::mutex> lock(inventoryMutex_);
+        result = target->applyDelta(msg.payload, 1);
+    }
+    
+    if (result == ClientInventory::DeltaResult::GAP || result == ClientInventory::DeltaResult::INVALID) {
+        // fall back to a full sync, the server answers with INVENTORY_FULL_SYNC / SHARED_STASH_UPDATE
+        std::cout << "Inventory " << (int)invType << " out of sync, requesting full sync" << std::endl;
+        requestSync(static_cast<InventoryType>(invType));
+    }
+}
+
 } // namespace inventory
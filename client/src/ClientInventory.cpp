@@ -1,28 +1,80 @@
 #include "ClientInventory.hpp"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 namespace inventory {
 
+namespace {
+
+bool readUint32(const std::vector<uint8_t>& data, size_t& offset, uint32_t& value) {
+    if (offset + 4 > data.size()) return false;
+    value = (static_cast<uint32_t>(data[offset]) << 24) |
+            (static_cast<uint32_t>(data[offset + 1]) << 16) |
+            (static_cast<uint32_t>(data[offset + 2]) << 8) |
+            static_cast<uint32_t>(data[offset + 3]);
+    offset += 4;
+    return true;
+}
+
+} // namespace
+
 ClientInventory::ClientInventory(int width, int height) 
-    : width_(width), height_(height) {
+    : width_(width), height_(height), version_(0) {
     std::cout << "ClientInventory created: " << width_ << "x" << height_ << std::endl;
 }
 
 void ClientInventory::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
     items_.clear();
 }
 
+bool ClientInventory::parseItemRecord(const std::vector<uint8_t>& data, size_t& offset, InventorySlot& slot) {
+    // [instanceId:8bytes][itemId:4bytes][stackCount:4bytes][itemName_length:1byte][itemName:n][size_w:1byte][size_h:1byte][stackLimit:4bytes]
+    uint32_t instanceHigh, instanceLow;
+    if (!readUint32(data, offset, instanceHigh)) return false;
+    if (!readUint32(data, offset, instanceLow)) return false;
+    
+    uint32_t itemId;
+    if (!readUint32(data, offset, itemId)) return false;
+    
+    uint32_t stackCount;
+    if (!readUint32(data, offset, stackCount)) return false;
+    
+    if (offset + 1 > data.size()) return false;
+    uint8_t nameLen = data[offset++];
+    
+    if (offset + nameLen > data.size()) return false;
+    std::string name(data.begin() + offset, data.begin() + offset + nameLen);
+    offset += nameLen;
+    
+    if (offset + 2 > data.size()) return false;
+    uint8_t sizeW = data[offset++];
+    uint8_t sizeH = data[offset++];
+    
+    uint32_t stackLimit;
+    if (!readUint32(data, offset, stackLimit)) return false;
+    
+    slot.item = ItemTable::intern(Item(itemId, name, ItemSize{sizeW, sizeH}, stackLimit, ""));
+    slot.stackCount = stackCount;
+    slot.instanceId = (static_cast<uint64_t>(instanceHigh) << 32) | instanceLow;
+    return true;
+}
+
 bool ClientInventory::updateFromSyncData(const std::vector<uint8_t>& data) {
-    if (data.size() < 4) {
+    if (data.size() < 8) {
         std::cerr << "Invalid sync data: too small" << std::endl;
         return false;
     }
     
-    // parse: [width:1byte][height:1byte][itemCount:2bytes]
+    // parse: [width:1byte][height:1byte][version:4bytes][itemCount:2bytes]
     uint8_t width = data[0];
     uint8_t height = data[1];
-    uint16_t itemCount = (static_cast<uint16_t>(data[2]) << 8) | data[3];
+    size_t offset = 2;
+    uint32_t version;
+    readUint32(data, offset, version);
+    uint16_t itemCount = (static_cast<uint16_t>(data[offset]) << 8) | data[offset + 1];
+    offset += 2;
     
     if (width != width_ || height != height_) {
         std::cerr << "Warning: inventory size mismatch (expected " 
@@ -30,9 +82,8 @@ bool ClientInventory::updateFromSyncData(const std::vector<uint8_t>& data) {
                   << (int)width << "x" << (int)height << ")" << std::endl;
     }
     
-    items_.clear();
-    
-    size_t offset = 4;
+    std::vector<InventorySlot> items;
+    items.reserve(itemCount);
     
     for (uint16_t i = 0; i < itemCount; ++i) {
         if (offset + 2 > data.size()) {
@@ -43,62 +94,86 @@ bool ClientInventory::updateFromSyncData(const std::vector<uint8_t>& data) {
         uint8_t x = data[offset++];
         uint8_t y = data[offset++];
         
-        if (offset + 4 > data.size()) return false;
-        uint32_t itemId = (static_cast<uint32_t>(data[offset]) << 24) |
-                         (static_cast<uint32_t>(data[offset + 1]) << 16) |
-                         (static_cast<uint32_t>(data[offset + 2]) << 8) |
-                         static_cast<uint32_t>(data[offset + 3]);
-        offset += 4;
-        
-        if (offset + 4 > data.size()) return false;
-        uint32_t stackCount = (static_cast<uint32_t>(data[offset]) << 24) |
-                             (static_cast<uint32_t>(data[offset + 1]) << 16) |
-                             (static_cast<uint32_t>(data[offset + 2]) << 8) |
-                             static_cast<uint32_t>(data[offset + 3]);
-        offset += 4;
-        
-        if (offset + 1 > data.size()) return false;
-        uint8_t nameLen = data[offset++];
-        
-        if (offset + nameLen > data.size()) return false;
-        std::string name(data.begin() + offset, data.begin() + offset + nameLen);
-        offset += nameLen;
-        
-        if (offset + 2 > data.size()) return false;
-        uint8_t sizeW = data[offset++];
-        uint8_t sizeH = data[offset++];
-        
-        if (offset + 4 > data.size()) return false;
-        uint32_t stackLimit = (static_cast<uint32_t>(data[offset]) << 24) |
-                             (static_cast<uint32_t>(data[offset + 1]) << 16) |
-                             (static_cast<uint32_t>(data[offset + 2]) << 8) |
-                             static_cast<uint32_t>(data[offset + 3]);
-        offset += 4;
-        
-        auto item = std::make_shared<Item>(itemId, name, ItemSize{sizeW, sizeH}, stackLimit, "");
-        
         InventorySlot slot;
-        slot.item = item;
-        slot.stackCount = stackCount;
+        if (!parseItemRecord(data, offset, slot)) return false;
         slot.position = GridPosition(x, y);
         
-        items_.push_back(slot);
+        items.push_back(slot);
     }
     
-    std::cout << "Updated inventory: " << items_.size() << " items" << std::endl;
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.swap(items);
+    version_ = version;
+    
+    std::cout << "Updated inventory: " << items_.size() << " items (version " << version_ << ")" << std::endl;
     return true;
 }
 
-const InventorySlot* ClientInventory::getSlot(int x, int y) const {
+ClientInventory::DeltaResult ClientInventory::applyDelta(const std::vector<uint8_t>& data, size_t offset) {
+    // parse: [baseVersion:4bytes][version:4bytes][changeCount:2bytes]
+    //        then per change [op:1byte][x:1byte][y:1byte] + item record when op is 1
+    uint32_t baseVersion;
+    uint32_t version;
+    if (!readUint32(data, offset, baseVersion) || !readUint32(data, offset, version)) {
+        return DeltaResult::INVALID;
+    }
+    if (offset + 2 > data.size()) {
+        return DeltaResult::INVALID;
+    }
+    uint16_t changeCount = (static_cast<uint16_t>(data[offset]) << 8) | data[offset + 1];
+    offset += 2;
+    
+    // every entry is the final state of its cell, so anything between base and version can apply it
+    if (version_ >= version) {
+        return DeltaResult::STALE;
+    }
+    if (version_ < baseVersion) {
+        return DeltaResult::GAP;
+    }
+    
+    // parse everything first, a truncated delta must not leave a half applied inventory
+    std::vector<std::pair<GridPosition, InventorySlot>> changes;
+    changes.reserve(changeCount);
+    for (uint16_t i = 0; i < changeCount; ++i) {
+        if (offset + 3 > data.size()) return DeltaResult::INVALID;
+        uint8_t op = data[offset++];
+        GridPosition pos(data[offset], data[offset + 1]);
+        offset += 2;
+        
+        InventorySlot slot;
+        if (op == 1) {
+            if (!parseItemRecord(data, offset, slot)) return DeltaResult::INVALID;
+            slot.position = pos;
+        }
+        changes.emplace_back(pos, slot);
+    }
+    
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [pos, slot] : changes) {
+        items_.erase(std::remove_if(items_.begin(), items_.end(),
+                                    [&pos](const InventorySlot& existing) { return existing.position == pos; }),
+                     items_.end());
+        if (slot.item) {
+            items_.push_back(slot);
+        }
+    }
+    
+    version_ = version;
+    return DeltaResult::APPLIED;
+}
+
+std::optional<InventorySlot> ClientInventory::getSlot(int x, int y) const {
+    std::lock_guard<std::mutex> lock(mutex_);
     for (const auto& slot : items_) {
         if (slot.position.x == x && slot.position.y == y) {
-            return &slot;
+            return slot;
         }
     }
-    return nullptr;
+    return std::nullopt;
 }
 
 std::vector<InventorySlot> ClientInventory::getAllItems() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     return items_;
 }
 
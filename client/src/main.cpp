@@ -3,6 +3,7 @@
 #include "ItemIcons.h"
 #include "raylib.h"
 #include <iostream>
+#include <optional>
 #include <string>
 #include <cstring>
 #include <cstdlib>
@@ -32,13 +33,14 @@ struct DragState
     bool isDragging;
     inventory::InventoryType sourceInventory;
     inventory::GridPosition sourcePos;
-    std::shared_ptr<inventory::Item> draggedItem;
+    inventory::ItemHandle draggedItem;
     uint32_t stackCount;
+    uint64_t instanceId;
     int mouseOffsetX;
     int mouseOffsetY;
 
     DragState() : isDragging(false), sourceInventory(inventory::InventoryType::PERSONAL),
-                  sourcePos(), draggedItem(nullptr), stackCount(0),
+                  sourcePos(), draggedItem(), stackCount(0), instanceId(0),
                   mouseOffsetX(0), mouseOffsetY(0) {}
 };
 
@@ -47,12 +49,12 @@ struct SplitDialogState
     bool active;
     inventory::InventoryType invType;
     inventory::GridPosition sourcePos;
-    std::shared_ptr<inventory::Item> item;
+    inventory::ItemHandle item;
     uint32_t maxAmount;
     char inputBuffer[16];
 
     SplitDialogState() : active(false), invType(inventory::InventoryType::PERSONAL),
-                         sourcePos(), item(nullptr), maxAmount(0)
+                         sourcePos(), item(), maxAmount(0)
     {
         inputBuffer[0] = '\0';
     }
@@ -112,11 +114,11 @@ void drawInventoryItems(const std::shared_ptr<inventory::ClientInventory> &inv,
     if (!inv)
         return;
 
-    auto items = inv->getAllItems();
-    for (const auto &slot : items)
+    // visited in place under the inventory's lock, nothing is copied per frame
+    inv->forEachItem([&](const inventory::InventorySlot &slot)
     {
         if (!slot.item)
-            continue;
+            return;
 
         // skip the drawing if this item is being dragged from this inventory
         if (dragState && dragState->isDragging &&
@@ -124,7 +126,7 @@ void drawInventoryItems(const std::shared_ptr<inventory::ClientInventory> &inv,
             slot.position.x == dragState->sourcePos.x &&
             slot.position.y == dragState->sourcePos.y)
         {
-            continue;
+            return;
         }
 
         int posX = offsetX + slot.position.x * (SLOT_SIZE + SLOT_PADDING);
@@ -225,7 +227,7 @@ void drawInventoryItems(const std::shared_ptr<inventory::ClientInventory> &inv,
                      posY + itemHeight - 18,
                      14, YELLOW);
         }
-    }
+    });
 }
 
 int main(int argc, char *argv[])
@@ -279,6 +281,9 @@ int main(int argc, char *argv[])
     inventory::GridPosition hoveredSlot(-1, -1);
     int currentStashIndex = 0; // current selected shared stash
 
+    // the server only sends updates for the stash tab we're looking at
+    client.subscribeStash(currentStashIndex);
+
     // icon texture cache
     std::unordered_map<std::string, Texture2D> iconCache;
 
@@ -305,6 +310,14 @@ int main(int argc, char *argv[])
                 currentStashIndex = 1;
             if (IsKeyPressed(KEY_THREE))
                 currentStashIndex = 2;
+
+            client.subscribeStash(currentStashIndex);
+
+            // server side sort (S: personal inventory, D: the stash on screen)
+            if (IsKeyPressed(KEY_S))
+                client.requestSortInventory(inventory::InventoryType::PERSONAL);
+            if (IsKeyPressed(KEY_D))
+                client.requestSortInventory(static_cast<inventory::InventoryType>(currentStashIndex + 1));
         }
 
         // which inventory mouse is over
@@ -333,7 +346,7 @@ int main(int argc, char *argv[])
                 {
                     inventory::GridPosition clickedPos = screenToInventoryGrid(mouseX, mouseY,
                                                                                INVENTORY_OFFSET_X, INVENTORY_OFFSET_Y);
-                    const auto *slot = personalInv->getSlot(clickedPos.x, clickedPos.y);
+                    std::optional<inventory::InventorySlot> slot = personalInv->getSlot(clickedPos.x, clickedPos.y);
 
                     if (slot && !slot->isEmpty() && slot->stackCount > 1)
                     {
@@ -360,7 +373,7 @@ int main(int argc, char *argv[])
                 {
                     inventory::GridPosition clickedPos = screenToInventoryGrid(mouseX, mouseY,
                                                                                INVENTORY_OFFSET_X, INVENTORY_OFFSET_Y);
-                    const auto *slot = personalInv->getSlot(clickedPos.x, clickedPos.y);
+                    std::optional<inventory::InventorySlot> slot = personalInv->getSlot(clickedPos.x, clickedPos.y);
 
                     std::cout << "Clicked inventory at (" << clickedPos.x << ", " << clickedPos.y << ")"
                               << " slot=" << (slot ? "exists" : "null")
@@ -373,6 +386,7 @@ int main(int argc, char *argv[])
                         dragState.sourcePos = clickedPos;
                         dragState.draggedItem = slot->item;
                         dragState.stackCount = slot->stackCount;
+                        dragState.instanceId = slot->instanceId;
 
                         // calculate the mouse offset within the item
                         int slotPosX = INVENTORY_OFFSET_X + clickedPos.x * (SLOT_SIZE + SLOT_PADDING);
@@ -393,7 +407,7 @@ int main(int argc, char *argv[])
                 {
                     inventory::GridPosition clickedPos = screenToInventoryGrid(mouseX, mouseY,
                                                                                STASH_OFFSET_X, STASH_OFFSET_Y);
-                    const auto *slot = sharedStash->getSlot(clickedPos.x, clickedPos.y);
+                    std::optional<inventory::InventorySlot> slot = sharedStash->getSlot(clickedPos.x, clickedPos.y);
 
                     if (slot && !slot->isEmpty())
                     {
@@ -403,6 +417,7 @@ int main(int argc, char *argv[])
                         dragState.sourcePos = clickedPos;
                         dragState.draggedItem = slot->item;
                         dragState.stackCount = slot->stackCount;
+                        dragState.instanceId = slot->instanceId;
 
                         // calculate mouse offset within the item
                         int slotPosX = STASH_OFFSET_X + clickedPos.x * (SLOT_SIZE + SLOT_PADDING);
@@ -457,10 +472,17 @@ int main(int argc, char *argv[])
                     }
                     std::cout << " (" << targetPos.x << ", " << targetPos.y << ")" << std::endl;
 
-                    // send MOVE_ITEM_REQUEST to server
-                    client.requestMoveItem(
-                        dragState.sourceInventory, dragState.sourcePos.x, dragState.sourcePos.y,
-                        destInventory, targetPos.x, targetPos.y);
+                    // by instance, so the move still finds the item if someone else shifted it meanwhile
+                    if (dragState.instanceId != 0)
+                    {
+                        client.requestMoveInstance(dragState.instanceId, destInventory, targetPos.x, targetPos.y);
+                    }
+                    else
+                    {
+                        client.requestMoveItem(
+                            dragState.sourceInventory, dragState.sourcePos.x, dragState.sourcePos.y,
+                            destInventory, targetPos.x, targetPos.y);
+                    }
                 }
                 else
                 {
@@ -473,7 +495,7 @@ int main(int argc, char *argv[])
             }
 
             dragState.isDragging = false;
-            dragState.draggedItem = nullptr;
+            dragState.draggedItem = inventory::ItemHandle();
         }
 
         BeginDrawing();
@@ -482,7 +504,7 @@ int main(int argc, char *argv[])
         // drawing title
         DrawText("Inventory System", 10, 10, 20, BLACK);
         DrawText(TextFormat("User: %s", client.getUsername().c_str()), 10, 35, 16, BLACK);
-        DrawText("Press ESC to exit | Keys 1-3: Switch Stash", 10, 55, 14, BLACK);
+        DrawText("Press ESC to exit | Keys 1-3: Switch Stash | S/D: Sort Inventory/Stash", 10, 55, 14, BLACK);
 
         // drawing shared stashes
         const int TAB_WIDTH = 80;
@@ -1,24 +1,70 @@
 #pragma once
 
+#include "FrameBuffer.hpp"
+#include "TimerWheel.hpp"
+#include "NetworkMessage.hpp"
+#include "PersonalInventoryTable.hpp"
 #include <string>
 #include <chrono>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
 
 namespace inventory {
 
+class Strand;
+
 class ClientSession {
 public:
-    ClientSession(int socket);
+    enum class FlushResult {
+        DONE,     // outbound queue is empty
+        PENDING,  // socket buffer is full, wait for EPOLLOUT
+        FAILED    // connection is broken
+    };
+    
+    ClientSession(int socket, uint64_t sessionId, int reactorIndex = 0, size_t maxOutboundBytes = 4 * 1024 * 1024);
     ~ClientSession();
     
     int getSocket() const { return socket_; }
     
-    const std::string& getUsername() const { return username_; }
+    // unique for the server's lifetime, unlike the socket number, which the next connection
+    // may get as soon as this one is closed
+    uint64_t getSessionId() const { return sessionId_; }
+    
+    // reactor thread that owns this session (reads, flushes and disconnects happen there)
+    int getReactorIndex() const { return reactorIndex_; }
+    
+    // bytes received but not yet parsed into messages, only touched by the owning reactor
+    FrameBuffer& getReceiveBuffer() { return receiveBuffer_; }
+    
+    // queue an encoded frame, safe to call from any thread
+    // the frame is shared, not copied, so one broadcast buffer can sit in many queues
+    // returns false (and marks the session as overflowed) when the reader is too far behind
+    bool enqueue(EncodedFrame frame);
+    
+    // write as much of the queue as the socket takes, in as few syscalls as possible
+    FlushResult flush();
+    
+    bool hasOverflowed() const { return overflowed_; }
+    size_t getOutboundBytes();
+    
+    // true if the caller is the one that has to schedule a flush with the owning reactor
+    bool markFlushScheduled() { return !flushScheduled_.exchange(true); }
+    void clearFlushScheduled() { flushScheduled_ = false; }
+    
+    const std::string& getUsername() const { return owner_.username; }
+    // the username hashed once at login, what the session's requests look its inventory up by
+    const PersonalKey& getPersonalKey() const { return owner_; }
     void setUsername(const std::string& username) { 
-        username_ = username;
+        owner_ = PersonalKey(username);
         lastActivity_ = std::chrono::steady_clock::now();
     }
     
-    bool isAuthenticated() const { return !username_.empty(); }
+    bool isAuthenticated() const { return !owner_.username.empty(); }
     
     void updateActivity() {
         lastActivity_ = std::chrono::steady_clock::now();
@@ -28,10 +74,33 @@ public:
         return lastActivity_;
     }
     
+    // the requests the reactor hands to the worker pool run through here, one at a time in order
+    const std::shared_ptr<Strand>& getStrand() const { return strand_; }
+    void setStrand(std::shared_ptr<Strand> strand) { strand_ = std::move(strand); }
+    
+    // idle timer in the owning reactor's wheel, a fired timer that doesn't match is stale
+    TimerWheel::TimerId getIdleTimer() const { return idleTimer_; }
+    void setIdleTimer(TimerWheel::TimerId timer) { idleTimer_ = timer; }
+    
 private:
     int socket_;
-    std::string username_;
+    uint64_t sessionId_;
+    int reactorIndex_;
+    FrameBuffer receiveBuffer_;
+    
+    // outbound frames, the front one may be partially written already
+    std::mutex outboundMutex_;
+    std::deque<EncodedFrame> outbound_;
+    size_t outboundOffset_;
+    size_t outboundBytes_;
+    size_t maxOutboundBytes_;
+    std::atomic<bool> overflowed_;
+    std::atomic<bool> flushScheduled_;
+    
+    PersonalKey owner_;
+    std::shared_ptr<Strand> strand_;
     std::chrono::steady_clock::time_point lastActivity_;
+    TimerWheel::TimerId idleTimer_;
 };
 
 } // namespace inventory
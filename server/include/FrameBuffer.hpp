@@ -0,0 +1,46 @@
+#pragma once
+
+#include "NetworkMessage.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace inventory {
+
+// growable ring buffer for the bytes received on a socket
+// recv() writes straight into it and complete [type:1][len:4][payload:len] frames are popped off the front,
+// so pipelined requests and frames split across segments are both handled
+class FrameBuffer {
+public:
+    enum class FrameResult {
+        FRAME,      // a complete frame was extracted
+        INCOMPLETE, // need more bytes
+        INVALID     // declared payload is larger than maxFrameSize, the stream can't be trusted anymore
+    };
+    
+    explicit FrameBuffer(size_t initialCapacity = 4096, size_t maxFrameSize = 1024 * 1024);
+    
+    // contiguous free space for the next recv (grows the buffer when it's full)
+    uint8_t* writeRegion(size_t& length);
+    void commit(size_t length);
+    
+    // pop the next complete frame
+    FrameResult nextFrame(NetworkMessage& msg);
+    
+    size_t size() const { return size_; }
+    size_t capacity() const { return data_.size(); }
+    
+private:
+    std::vector<uint8_t> data_;  // capacity is always a power of two
+    size_t head_;
+    size_t size_;
+    size_t maxFrameSize_;
+    
+    size_t mask() const { return data_.size() - 1; }
+    uint8_t at(size_t offset) const { return data_[(head_ + offset) & mask()]; }
+    void copyOut(size_t offset, size_t length, uint8_t* dest) const;
+    void consume(size_t length);
+    void grow();
+};
+
+} // namespace inventory
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <array>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+
+namespace inventory {
+
+// instance id -> where that stack currently lies, across every inventory it observes
+// kept up to date by the inventories themselves (place/remove notify it), so a request naming
+// an instance finds it in O(1) no matter how often other players moved it in the meantime
+// split into shards by instance id, each with its own lock on its own cache line: every place and
+// remove on any inventory writes here, so one lock would have every worker and actor queueing on it
+class InstanceIndex : public InventoryObserver {
+public:
+    static constexpr size_t SHARD_COUNT = 64;
+
+    struct Location {
+        Inventory* inventory;
+        GridPosition origin;
+    };
+    
+    // start indexing an inventory (and everything already in it)
+    void attach(Inventory* inventory);
+    // stop indexing it and drop its entries, before the inventory goes away
+    void detach(Inventory* inventory);
+    
+    std::optional<Location> find(uint64_t instanceId) const;
+    size_t size() const;
+    
+    void onPlaced(Inventory& inventory, const InventorySlot& slot) override;
+    void onRemoved(Inventory& inventory, const InventorySlot& slot) override;
+    
+private:
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, Location> locations;
+    };
+
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    // ids are handed out in sequence, so the low bits spread stacks placed together over all shards
+    const Shard& shardFor(uint64_t instanceId) const { return shards_[instanceId % SHARD_COUNT]; }
+    Shard& shardFor(uint64_t instanceId) { return shards_[instanceId % SHARD_COUNT]; }
+};
+
+} // namespace inventory
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <array>
+#include <initializer_list>
+
+namespace inventory {
+
+// exclusive locks on every inventory an operation touches, held for its whole scope
+// the locks are always taken in one global order (by address), so two operations that share
+// inventories can't deadlock, and operations on disjoint inventories don't wait for each other
+// the server locks personal inventories this way, shared stashes belong to their StashActor
+// readers never lock, they read the inventory's published snapshot (Inventory::readSnapshot)
+class InventoryLock {
+public:
+    static constexpr size_t MAX_INVENTORIES = 4;
+
+    // nullptrs and duplicates are skipped
+    explicit InventoryLock(std::initializer_list<Inventory*> inventories);
+    ~InventoryLock();
+
+    InventoryLock(const InventoryLock&) = delete;
+    InventoryLock& operator=(const InventoryLock&) = delete;
+
+private:
+    std::array<Inventory*, MAX_INVENTORIES> locked_;  // sorted, the first count_ are held
+    size_t count_;
+};
+
+} // namespace inventory
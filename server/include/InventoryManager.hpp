@@ -2,10 +2,11 @@
 
 #include "Inventory.hpp"
 #include "SharedStashManager.hpp"
+#include "InventoryTransaction.hpp"
+#include "InstanceIndex.hpp"
+#include "PersonalInventoryTable.hpp"
 #include <string>
-#include <unordered_map>
 #include <memory>
-#include <mutex>
 
 namespace inventory {
 
@@ -17,15 +18,20 @@ public:
     InventoryManager();
     ~InventoryManager();
     
-    // Personal inventory management
-    Inventory* getOrCreatePersonalInventory(const std::string& username);
-    Inventory* getPersonalInventory(const std::string& username);
-    void removePersonalInventory(const std::string& username);
+    // Personal inventory management, by the player's pre-hashed name (see PersonalInventoryTable)
+    Inventory* getOrCreatePersonalInventory(const PersonalKey& owner);
+    Inventory* getPersonalInventory(const PersonalKey& owner);
+    void removePersonalInventory(const PersonalKey& owner);
+    // copy of the latest published snapshot, for readers that keep it around (admin console)
+    std::optional<InventorySnapshot> getPersonalSnapshot(const PersonalKey& owner);
     
     // Shared stash access (0, 1, or 2)
     std::shared_ptr<Inventory> getSharedStash(int stashIndex);
     
-    // Item operations
+    // where a stack is right now, by its instance id (every managed inventory is indexed)
+    std::optional<InstanceIndex::Location> findInstance(uint64_t instanceId) const;
+    
+    // Item operations, the caller owns every inventory passed in (InventoryLock, or the stash's actor)
     enum class OperationResult {
         SUCCESS,
         INVALID_SOURCE,
@@ -33,9 +39,13 @@ public:
         ITEM_NOT_FOUND,
         NO_SPACE,
         INVALID_STACK_SIZE,
-        CONCURRENT_MODIFICATION
+        CONCURRENT_MODIFICATION,
+        STALE_VIEW               // the request was made against an older version of the inventory
     };
     
+    // optimistic check done before any grid work: no expected version means the caller doesn't care
+    static bool isStale(const Inventory* inventory, std::optional<uint32_t> expectedVersion);
+    
     // Move item within same inventory or between inventories
     OperationResult moveItem(
         Inventory* sourceInv,
@@ -52,9 +62,30 @@ public:
         const GridPosition& destPos
     );
     
+    // Same operations as steps of a bigger transaction: on anything but SUCCESS the caller
+    // aborts the transaction (the failed step may have done part of its work in it)
+    OperationResult moveItem(
+        InventoryTransaction& transaction,
+        Inventory* sourceInv,
+        const GridPosition& sourcePos,
+        Inventory* destInv,
+        const GridPosition& destPos
+    );
+    OperationResult splitStack(
+        InventoryTransaction& transaction,
+        Inventory* inventory,
+        const GridPosition& pos,
+        int amount,
+        const GridPosition& destPos
+    );
+    
+    // Merge partial stacks and pack the whole inventory (see InventoryPacker), applied all at once
+    OperationResult sortInventory(Inventory* inventory);
+    
 private:
-    std::unordered_map<std::string, std::unique_ptr<Inventory>> personalInventories_;
-    std::mutex inventoriesMutex_;
+    InstanceIndex instanceIndex_;  // declared first, the inventories below report to it until they're gone
+    
+    PersonalInventoryTable personalInventories_;
     
     std::unique_ptr<SharedStashManager> sharedStashManager_;
 };
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <vector>
+#include <memory>
+
+namespace inventory {
+
+// plans a compacted layout for an inventory (SORT_INVENTORY):
+// partial stacks of the same item are merged up to their stack limit, then every stack
+// is packed first-fit into an empty grid, biggest footprint first and then by item id
+// merging only ever reduces the number of stacks, so every output stack keeps an existing instance id
+class InventoryPacker {
+public:
+    struct Placement {
+        ItemHandle item;
+        uint32_t count;
+        GridPosition position;
+        uint64_t instanceId;  // reused from one of the merged stacks of the same item
+    };
+    
+    // false when no packing order fits everything back in (the inventory should be left as it is)
+    static bool pack(const Inventory& inventory, std::vector<Placement>& layout);
+    
+    // true if applying layout wouldn't change anything
+    static bool matches(const Inventory& inventory, const std::vector<Placement>& layout);
+};
+
+} // namespace inventory
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <vector>
+#include <memory>
+#include <utility>
+
+namespace inventory {
+
+// a batch of item steps across one or more inventories that lands as a whole or not at all
+// every step is validated before it touches the grid and recorded in an undo log, abort() replays
+// the log backwards and rewinds each inventory's version and change log, so an aborted batch
+// leaves nothing behind (not even no-op entries in the next delta)
+// the caller owns every inventory involved for the whole transaction (an InventoryLock on the
+// personal ones, a stash only on its actor's thread), nobody sees the steps in between
+class InventoryTransaction {
+public:
+    InventoryTransaction() = default;
+    ~InventoryTransaction();  // aborts if neither commit() nor abort() was called
+    
+    InventoryTransaction(const InventoryTransaction&) = delete;
+    InventoryTransaction& operator=(const InventoryTransaction&) = delete;
+    
+    // steps, each one either applies completely or returns false and changes nothing
+    // (instanceId 0 places a new stack, otherwise the stack keeps the id it had before)
+    bool place(Inventory* inventory, ItemHandle item, uint32_t count, GridPosition pos, uint64_t instanceId = 0);
+    std::optional<InventorySlot> remove(Inventory* inventory, GridPosition pos);
+    bool setStackCount(Inventory* inventory, GridPosition pos, uint32_t count);
+    bool adjustStack(Inventory* inventory, GridPosition pos, int32_t delta);
+    uint32_t mergeInto(Inventory* sourceInv, GridPosition src, Inventory* destInv, GridPosition dst);  // amount moved, 0 changes nothing
+    
+    void commit();
+    void abort();
+    
+    bool isOpen() const { return open_; }
+    
+private:
+    struct UndoEntry {
+        enum class Kind { PLACED, REMOVED, COUNT_CHANGED } kind;
+        Inventory* inventory;
+        InventorySlot slot;  // PLACED: origin only, REMOVED: the removed stack, COUNT_CHANGED: previous count
+    };
+    
+    std::vector<UndoEntry> undoLog_;
+    std::vector<std::pair<Inventory*, Inventory::Checkpoint>> checkpoints_;  // first touch of each inventory
+    bool open_ = true;
+    
+    void touch(Inventory* inventory);
+};
+
+} // namespace inventory
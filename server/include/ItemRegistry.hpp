@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Item.hpp"
+#include "ItemTable.hpp"
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -8,6 +9,7 @@
 namespace inventory {
 
 // registry of all available items
+// items live in the shared ItemTable, the registry only maps ids to their handles
 class ItemRegistry {
 public:
     static ItemRegistry& getInstance();
@@ -15,16 +17,16 @@ public:
     void initialize();
     
     // get item by id
-    std::shared_ptr<Item> getItem(uint32_t id) const;
+    ItemHandle getItem(uint32_t id) const;
     
     // get all items
-    std::vector<std::shared_ptr<Item>> getAllItems() const;
+    std::vector<ItemHandle> getAllItems() const;
     
 private:
     ItemRegistry() = default;
-    std::unordered_map<uint32_t, std::shared_ptr<Item>> items_;
+    std::unordered_map<uint32_t, ItemHandle> items_;  // only written by initialize()
     
-    void registerItem(std::shared_ptr<Item> item);
+    void registerItem(const Item& item);
 };
 
 } // namespace inventory
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+namespace inventory {
+
+// unbounded lock-free multi-producer single-consumer queue (Vyukov's linked list with a stub node)
+// push is one atomic exchange plus one store, from any number of threads; pop belongs to a single
+// consumer thread and never blocks a producer
+// pop can briefly report empty while a producer is between its two steps, consumers that must not
+// miss an item count pushes separately (see Strand)
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) {}
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    void push(T value) {
+        Node* node = new Node(std::move(value));
+        link(node);
+    }
+
+    // consumer thread only
+    bool pop(T& value) {
+        Node* tail = tail_;
+        Node* next = tail->next.load(std::memory_order_acquire);
+
+        // skip the stub, it carries no value
+        if (tail == &stub_) {
+            if (!next) {
+                return false;
+            }
+            tail_ = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next) {
+            tail_ = next;
+            value = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+
+        // tail is the last node: a producer is halfway through pushing behind it, or it really is
+        // the last one and the stub goes back in so tail can be handed out
+        if (tail != head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        link(&stub_);
+
+        next = tail->next.load(std::memory_order_acquire);
+        if (next) {
+            tail_ = next;
+            value = std::move(tail->value);
+            delete tail;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value;
+
+        Node() = default;
+        explicit Node(T v) : value(std::move(v)) {}
+    };
+
+    std::atomic<Node*> head_;  // last pushed, producers swing it
+    Node* tail_;               // next to pop, consumer only
+    Node stub_;
+
+    void link(Node* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+};
+
+} // namespace inventory
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <array>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace inventory {
+
+// a username with its hash worked out once, sessions keep one so a request's lookups don't rehash
+// implicit from a plain name for the paths that only have one (admin console)
+struct PersonalKey {
+    std::string username;
+    size_t hash;
+
+    PersonalKey() : hash(std::hash<std::string>()(std::string())) {}
+    PersonalKey(const std::string& name) : username(name), hash(std::hash<std::string>()(name)) {}
+
+    bool operator==(const PersonalKey& other) const {
+        return hash == other.hash && username == other.username;
+    }
+
+    struct Hash {
+        size_t operator()(const PersonalKey& key) const { return key.hash; }
+    };
+};
+
+// username -> personal inventory, split into shards by the key's hash
+// every shard has its own reader/writer lock on its own cache line: lookups from different
+// reactors only meet when they land in the same shard, and even then they share the lock;
+// only login and logout take a shard exclusively
+// inventories are owned by the table and never move while they're in it
+class PersonalInventoryTable {
+public:
+    static constexpr size_t SHARD_COUNT = 64;
+
+    Inventory* find(const PersonalKey& key) const;
+
+    // the inventory under key, made by create() (under the shard's lock) if there is none yet
+    Inventory* findOrCreate(const PersonalKey& key, const std::function<std::unique_ptr<Inventory>()>& create);
+
+    // hands the inventory back to the caller, nullptr if there was none
+    std::unique_ptr<Inventory> remove(const PersonalKey& key);
+
+    // visit(const Inventory&) under the shard's shared lock, the inventory can't be removed meanwhile
+    // false if there is no inventory under key
+    template <typename F>
+    bool visit(const PersonalKey& key, F&& visitor) const {
+        const Shard& shard = shardFor(key);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.inventories.find(key);
+        if (it == shard.inventories.end()) {
+            return false;
+        }
+        visitor(static_cast<const Inventory&>(*it->second));
+        return true;
+    }
+
+private:
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<PersonalKey, std::unique_ptr<Inventory>, PersonalKey::Hash> inventories;
+    };
+
+    std::array<Shard, SHARD_COUNT> shards_;
+
+    // high bits pick the shard, the shard's map buckets on the low ones
+    const Shard& shardFor(const PersonalKey& key) const { return shards_[(key.hash >> 24) % SHARD_COUNT]; }
+    Shard& shardFor(const PersonalKey& key) { return shards_[(key.hash >> 24) % SHARD_COUNT]; }
+};
+
+} // namespace inventory
@@ -1,20 +1,45 @@
 #pragma once
 
+#include "Inventory.hpp"
 #include <memory>
+#include <optional>
 #include <thread>
 #include <atomic>
 #include <string>
 #include <vector>
+#include <cstddef>
 
 namespace inventory {
 
 class ServerImpl;
-class Inventory;
 class Item;
 
+struct ServerConfig {
+    // reactor threads, <= 0 uses one reactor per hardware thread
+    int reactorThreads = 0;
+    
+    // worker threads running the request handlers and stash commands, <= 0 uses one per hardware thread
+    int workerThreads = 0;
+    
+    // outbound bytes a session may have queued before it is dropped as a slow reader
+    size_t maxOutboundBytes = 4 * 1024 * 1024;
+
+    // shared stash changes are collected and sent to subscribers once per tick (ms),
+    // 0 has each stash's actor send them whenever it runs out of work instead
+    int stashTickMs = 20;
+    
+    // idle sessions get a HEARTBEAT after heartbeatIntervalMs and are dropped after sessionTimeoutMs
+    // without any traffic from the client, heartbeatIntervalMs <= 0 disables the reaper
+    int heartbeatIntervalMs = 5000;
+    int sessionTimeoutMs = 15000;
+    
+    // resolution of the per-reactor timer wheel
+    int timerTickMs = 100;
+};
+
 class Server {
 public:
-    Server(int port);
+    Server(int port, const ServerConfig& config = ServerConfig());
     ~Server();
     
     void start();
@@ -26,10 +51,14 @@ public:
     // test/admin api
     std::vector<std::string> getConnectedPlayers() const;
     bool giveItem(const std::string& username, uint32_t itemId, uint32_t count);
-    Inventory* getPlayerInventory(const std::string& username);
+    // a copy of what the player's inventory looked like after the last finished operation
+    std::optional<InventorySnapshot> getPlayerInventory(const std::string& username);
+    // the socket the player's session is on, nullopt if not logged in
+    std::optional<int> getPlayerSocket(const std::string& username) const;
     
 private:
     int port_;
+    ServerConfig config_;
     std::atomic<bool> running_;
     std::unique_ptr<ServerImpl> impl_;
     std::thread serverThread_;
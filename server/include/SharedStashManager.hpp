@@ -1,7 +1,6 @@
 #pragma once
 
 #include "Inventory.hpp"
-#include <mutex>
 #include <memory>
 
 namespace inventory {
@@ -14,8 +13,7 @@ public:
     std::shared_ptr<Inventory> getSharedStash(int stashIndex);
     
 private:
-    std::shared_ptr<Inventory> stashes_[3];
-    std::mutex stashMutexes_[3];
+    std::shared_ptr<Inventory> stashes_[3];  // each only touched on its StashActor's thread
 };
 
 } // namespace inventory
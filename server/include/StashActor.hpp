@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include "WorkerPool.hpp"
+#include <functional>
+#include <deque>
+#include <memory>
+
+namespace inventory {
+
+// the single owner of one shared stash
+// every operation on the stash is a command posted to the actor and run on its strand, one at a
+// time in arrival order: the stash needs no lock, and a burst of players working the same stash
+// queues up fairly instead of fighting over a mutex
+// the strand runs on the worker pool (with the stash's index as affinity), an idle stash costs no thread
+// after every batch the actor publishes the stash's snapshot, the read side for other threads
+class StashActor {
+public:
+    using Command = std::function<void()>;
+
+    StashActor(int stashIndex, Inventory* stash, WorkerPool& pool);
+
+    StashActor(const StashActor&) = delete;
+    StashActor& operator=(const StashActor&) = delete;
+
+    // from any thread
+    void post(Command command);
+    // also runs while the actor is parked (handoff steps, flushes)
+    void postUrgent(Command command);
+
+    // run after every batch of commands, on the actor's strand
+    void setBatchHook(Command hook) { batchHook_ = std::move(hook); }
+
+    int getIndex() const { return index_; }
+    Inventory* getStash() const { return stash_; }
+    bool onActorThread() const { return strand_->runningHere(); }
+
+    // on the actor only, for the two-step handoff of a stack to another actor:
+    // after lifting the stack this actor parks until the other side answers, ordinary commands
+    // wait (in order) and nothing may be deposited onto the cells the stack came from,
+    // so whatever the other side sends back always fits where it was
+    void park(GridPosition origin, ItemSize size);
+    void unpark();
+    bool isParked() const { return parked_; }
+    bool isReserved(GridPosition pos, ItemSize size) const;
+
+private:
+    int index_;
+    Inventory* stash_;
+    std::shared_ptr<Strand> strand_;
+
+    std::deque<Command> deferred_;  // ordinary commands that arrived while parked
+    Command batchHook_;
+
+    bool parked_;
+    GridPosition reservedOrigin_;
+    ItemSize reservedSize_;
+
+    void dispatch(Command& command, bool urgent);
+};
+
+} // namespace inventory
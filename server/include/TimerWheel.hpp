@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace inventory {
+
+// hierarchical timing wheel: 4 levels of 64 slots, each level 64 times coarser than the one below
+// schedule and cancel are O(1), advancing a tick only touches the timers due in that slot
+// (plus one cascade of a coarser slot every 64 ticks), no matter how many timers are pending
+// not thread safe, every reactor owns its own wheel
+class TimerWheel {
+public:
+    using TimerId = uint32_t;
+    static constexpr TimerId INVALID_TIMER = 0xFFFFFFFF;
+
+    struct Expiry {
+        TimerId id;
+        uint64_t key;
+    };
+
+    TimerWheel();
+
+    // fire after delayTicks ticks (at least one), key is handed back on expiry
+    TimerId schedule(uint64_t delayTicks, uint64_t key);
+    void cancel(TimerId id);
+
+    // move time forward, due timers are released and appended to expired
+    // (collected instead of called back, so handlers can schedule and cancel freely)
+    void advance(uint64_t ticks, std::vector<Expiry>& expired);
+
+    uint64_t now() const { return current_; }
+    size_t pending() const { return pending_; }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int32_t NONE = -1;
+
+    struct Node {
+        uint64_t expiry = 0;
+        uint64_t key = 0;
+        int32_t prev = NONE;
+        int32_t next = NONE;
+        int32_t slot = NONE;  // index into heads_, NONE while free
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<int32_t> freeNodes_;
+    int32_t heads_[LEVELS * SLOTS];
+    uint64_t current_;
+    size_t pending_;
+
+    void insert(int32_t index);
+    void unlink(int32_t index);
+    void cascade(int level);
+    void tick(std::vector<Expiry>& expired);
+};
+
+} // namespace inventory
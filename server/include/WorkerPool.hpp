@@ -0,0 +1,103 @@
+#pragma once
+
+#include "MpscQueue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace inventory {
+
+// the threads request handlers, serialization and stash commands run on, so one expensive
+// request keeps a worker busy instead of the reactor that reads everybody else's sockets
+// every worker has its own deque: a task goes to the worker its affinity picks (same target
+// inventory, same worker, warm caches), a worker that runs dry steals from the others
+class WorkerPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkerPool(int workerCount);  // <= 0: one per hardware thread
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void start();
+    // runs everything queued, and whatever those tasks submit in turn, then joins the workers; tasks
+    // submitted while stopped wait for the next start, so no strand is left waiting for a lost turn
+    void stop();
+
+    // from any thread
+    void submit(Task task, size_t affinity);
+
+    size_t getWorkerCount() const { return workers_.size(); }
+
+private:
+    struct alignas(64) Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;  // the owner takes from the front, thieves from the back
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_;
+    std::atomic<size_t> queued_;  // tasks in all deques, what a worker checks before it sleeps
+    std::atomic<size_t> unfinished_;  // queued or running: a task's own submits count before it's done
+
+    std::mutex sleepMutex_;
+    std::condition_variable wakeup_;
+    std::condition_variable drained_;  // unfinished_ reached 0
+    std::atomic<int> sleeping_;
+
+    void run(size_t index);
+    bool takeTask(size_t index, Task& task);
+};
+
+// tasks run one at a time in the order they were posted, on whichever worker picks the strand up
+// (a session's requests, a stash's commands) - a serial queue without a thread of its own
+// posting is lock free, only the post that finds the strand idle submits it to the pool
+class Strand : public std::enable_shared_from_this<Strand> {
+public:
+    using Task = WorkerPool::Task;
+
+    // make with std::make_shared, queued runs keep the strand alive
+    Strand(WorkerPool& pool, size_t affinity);
+
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+
+    // from any thread
+    void post(Task task);
+
+    // where the next runs go (a session moves to its player's key after login)
+    void setAffinity(size_t affinity) { affinity_ = affinity; }
+
+    // run after every batch of tasks, on the strand
+    void setBatchHook(Task hook) { batchHook_ = std::move(hook); }
+
+    // tasks still queued (or posted later) are dropped
+    void close() { closed_ = true; }
+
+    // true on the thread running the strand's tasks right now
+    bool runningHere() const;
+
+private:
+    static constexpr size_t BATCH_LIMIT = 64;  // then the strand goes back to the pool, other work gets a turn
+
+    WorkerPool& pool_;
+    std::atomic<size_t> affinity_;
+    MpscQueue<Task> queue_;
+    std::atomic<size_t> pending_;  // posted and not run yet, the post that makes it 1 submits the strand
+    std::atomic<bool> closed_;
+    Task batchHook_;
+
+    void submit();
+    void drain();
+};
+
+} // namespace inventory
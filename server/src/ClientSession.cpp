@@ -1,13 +1,106 @@
 #include "ClientSession.hpp"
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 namespace inventory {
 
-ClientSession::ClientSession(int socket) 
+namespace {
+
+// frames handed to a single sendmsg call
+const size_t MAX_IOV = 64;
+
+} // namespace
+
+ClientSession::ClientSession(int socket, uint64_t sessionId, int reactorIndex, size_t maxOutboundBytes) 
     : socket_(socket), 
-      lastActivity_(std::chrono::steady_clock::now()) {
+      sessionId_(sessionId),
+      reactorIndex_(reactorIndex),
+      outboundOffset_(0),
+      outboundBytes_(0),
+      maxOutboundBytes_(maxOutboundBytes),
+      overflowed_(false),
+      flushScheduled_(false),
+      lastActivity_(std::chrono::steady_clock::now()),
+      idleTimer_(TimerWheel::INVALID_TIMER) {
 }
 
 ClientSession::~ClientSession() {
 }
 
+bool ClientSession::enqueue(EncodedFrame frame) {
+    std::lock_guard<std::mutex> lock(outboundMutex_);
+    
+    if (overflowed_) {
+        return false;
+    }
+    
+    // a reader this far behind gets dropped, queueing forever would only hide the problem
+    // and skipping frames would leave the client with a corrupted view
+    if (outboundBytes_ + frame->size() > maxOutboundBytes_) {
+        overflowed_ = true;
+        return false;
+    }
+    
+    outboundBytes_ += frame->size();
+    outbound_.push_back(std::move(frame));
+    return true;
+}
+
+size_t ClientSession::getOutboundBytes() {
+    std::lock_guard<std::mutex> lock(outboundMutex_);
+    return outboundBytes_;
+}
+
+ClientSession::FlushResult ClientSession::flush() {
+    std::lock_guard<std::mutex> lock(outboundMutex_);
+    
+    while (!outbound_.empty()) {
+        // gather everything queued since the last flush into one syscall
+        iovec iov[MAX_IOV];
+        size_t iovCount = 0;
+        size_t offset = outboundOffset_;
+        for (auto it = outbound_.begin(); it != outbound_.end() && iovCount < MAX_IOV; ++it) {
+            // iovec wants a non-const pointer, sendmsg only reads from it
+            iov[iovCount].iov_base = const_cast<uint8_t*>((*it)->data()) + offset;
+            iov[iovCount].iov_len = (*it)->size() - offset;
+            offset = 0;
+            ++iovCount;
+        }
+        
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = iovCount;
+        
+        // sendmsg is writev with flags: MSG_NOSIGNAL keeps a vanished peer from raising SIGPIPE
+        ssize_t written = sendmsg(socket_, &message, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return FlushResult::PENDING;
+            }
+            return FlushResult::FAILED;
+        }
+        
+        // drop whatever went out, remember where we stopped inside a partially written frame
+        size_t remaining = static_cast<size_t>(written);
+        outboundBytes_ -= remaining;
+        while (remaining > 0) {
+            size_t left = outbound_.front()->size() - outboundOffset_;
+            if (remaining >= left) {
+                remaining -= left;
+                outbound_.pop_front();
+                outboundOffset_ = 0;
+            } else {
+                outboundOffset_ += remaining;
+                remaining = 0;
+            }
+        }
+    }
+    
+    return FlushResult::DONE;
+}
+
 } // namespace inventory
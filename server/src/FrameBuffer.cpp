@@ -0,0 +1,93 @@
+#include "FrameBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace inventory {
+
+namespace {
+
+const size_t HEADER_SIZE = 5;
+
+size_t roundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+FrameBuffer::FrameBuffer(size_t initialCapacity, size_t maxFrameSize)
+    : data_(roundUpToPowerOfTwo(std::max<size_t>(initialCapacity, HEADER_SIZE))),
+      head_(0),
+      size_(0),
+      maxFrameSize_(maxFrameSize) {
+}
+
+uint8_t* FrameBuffer::writeRegion(size_t& length) {
+    if (size_ == data_.size()) {
+        grow();
+    }
+    
+    size_t tail = (head_ + size_) & mask();
+    if (tail >= head_) {
+        // free space runs to the end of the storage, the part before head_ is used by the next recv
+        length = data_.size() - tail;
+    } else {
+        length = head_ - tail;
+    }
+    return data_.data() + tail;
+}
+
+void FrameBuffer::commit(size_t length) {
+    size_ += length;
+}
+
+FrameBuffer::FrameResult FrameBuffer::nextFrame(NetworkMessage& msg) {
+    if (size_ < HEADER_SIZE) {
+        return FrameResult::INCOMPLETE;
+    }
+    
+    uint32_t payloadSize = (static_cast<uint32_t>(at(1)) << 24) |
+                           (static_cast<uint32_t>(at(2)) << 16) |
+                           (static_cast<uint32_t>(at(3)) << 8) |
+                           static_cast<uint32_t>(at(4));
+    
+    if (payloadSize > maxFrameSize_) {
+        return FrameResult::INVALID;
+    }
+    
+    if (size_ < HEADER_SIZE + payloadSize) {
+        return FrameResult::INCOMPLETE;
+    }
+    
+    msg.type = static_cast<MessageType>(at(0));
+    msg.payload.resize(payloadSize);
+    copyOut(HEADER_SIZE, payloadSize, msg.payload.data());
+    consume(HEADER_SIZE + payloadSize);
+    
+    return FrameResult::FRAME;
+}
+
+void FrameBuffer::copyOut(size_t offset, size_t length, uint8_t* dest) const {
+    size_t start = (head_ + offset) & mask();
+    size_t firstPart = std::min(length, data_.size() - start);
+    std::memcpy(dest, data_.data() + start, firstPart);
+    std::memcpy(dest + firstPart, data_.data(), length - firstPart);
+}
+
+void FrameBuffer::consume(size_t length) {
+    size_ -= length;
+    // an empty buffer starts over at 0 so the next recv gets the largest contiguous region
+    head_ = size_ == 0 ? 0 : (head_ + length) & mask();
+}
+
+void FrameBuffer::grow() {
+    std::vector<uint8_t> larger(data_.size() * 2);
+    copyOut(0, size_, larger.data());
+    data_.swap(larger);
+    head_ = 0;
+}
+
+} // namespace inventory
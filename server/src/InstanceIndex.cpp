@@ -0,0 +1,64 @@
+#include "InstanceIndex.hpp"
+
+namespace inventory {
+
+void InstanceIndex::attach(Inventory* inventory) {
+    if (!inventory) {
+        return;
+    }
+    
+    inventory->forEachItem([this, inventory](const InventorySlot& slot) {
+        onPlaced(*inventory, slot);
+    });
+    inventory->setObserver(this);
+}
+
+void InstanceIndex::detach(Inventory* inventory) {
+    if (!inventory) {
+        return;
+    }
+    
+    inventory->setObserver(nullptr);
+    inventory->forEachItem([this, inventory](const InventorySlot& slot) {
+        onRemoved(*inventory, slot);
+    });
+}
+
+std::optional<InstanceIndex::Location> InstanceIndex::find(uint64_t instanceId) const {
+    const Shard& shard = shardFor(instanceId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    
+    auto it = shard.locations.find(instanceId);
+    if (it == shard.locations.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+size_t InstanceIndex::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.locations.size();
+    }
+    return total;
+}
+
+void InstanceIndex::onPlaced(Inventory& inventory, const InventorySlot& slot) {
+    Shard& shard = shardFor(slot.instanceId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.locations[slot.instanceId] = Location{&inventory, slot.position};
+}
+
+void InstanceIndex::onRemoved(Inventory& inventory, const InventorySlot& slot) {
+    Shard& shard = shardFor(slot.instanceId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    
+    // only forget the entry if it still describes this stack
+    auto it = shard.locations.find(slot.instanceId);
+    if (it != shard.locations.end() && it->second.inventory == &inventory && it->second.origin == slot.position) {
+        shard.locations.erase(it);
+    }
+}
+
+} // namespace inventory
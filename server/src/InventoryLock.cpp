@@ -0,0 +1,28 @@
+#include "InventoryLock.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace inventory {
+
+InventoryLock::InventoryLock(std::initializer_list<Inventory*> inventories)
+    : locked_(), count_(0) {
+    for (Inventory* inventory : inventories) {
+        if (inventory && count_ < MAX_INVENTORIES &&
+            std::find(locked_.begin(), locked_.begin() + count_, inventory) == locked_.begin() + count_) {
+            locked_[count_++] = inventory;
+        }
+    }
+    
+    std::sort(locked_.begin(), locked_.begin() + count_, std::less<Inventory*>());
+    for (size_t i = 0; i < count_; ++i) {
+        locked_[i]->getMutex().lock();
+    }
+}
+
+InventoryLock::~InventoryLock() {
+    for (size_t i = count_; i > 0; --i) {
+        locked_[i - 1]->getMutex().unlock();
+    }
+}
+
+} // namespace inventory
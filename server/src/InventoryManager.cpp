@@ -1,45 +1,52 @@
 #include "InventoryManager.hpp"
+#include "InventoryPacker.hpp"
+#include "InventoryTransaction.hpp"
+#include "FixedInventory.hpp"
+#include <algorithm>
 #include <iostream>
 
 namespace inventory {
 
 InventoryManager::InventoryManager() {
     sharedStashManager_ = std::make_unique<SharedStashManager>();
+    for (int i = 0; i < 3; ++i) {
+        instanceIndex_.attach(sharedStashManager_->getSharedStash(i).get());
+    }
 }
 
 InventoryManager::~InventoryManager() = default;
 
-Inventory* InventoryManager::getOrCreatePersonalInventory(const std::string& username) {
-    std::lock_guard<std::mutex> lock(inventoriesMutex_);
-    
-    auto it = personalInventories_.find(username);
-    if (it != personalInventories_.end()) {
-        return it->second.get();
-    }
-    
-    // new personal inventory: 12 wide x 5 tall
-    auto inventory = std::make_unique<Inventory>(12, 5);
-    Inventory* ptr = inventory.get();
-    personalInventories_[username] = std::move(inventory);
-    
-    std::cout << "Created personal inventory for " << username << " (12 wide x 5 tall)" << std::endl;
-    return ptr;
+Inventory* InventoryManager::getOrCreatePersonalInventory(const PersonalKey& owner) {
+    return personalInventories_.findOrCreate(owner, [this, &owner]() {
+        // new personal inventory: 12 wide x 5 tall
+        std::unique_ptr<Inventory> inventory = std::make_unique<PersonalInventoryGrid>();
+        instanceIndex_.attach(inventory.get());
+        
+        std::cout << "Created personal inventory for " << owner.username << " (12 wide x 5 tall)" << std::endl;
+        return inventory;
+    });
 }
 
-Inventory* InventoryManager::getPersonalInventory(const std::string& username) {
-    std::lock_guard<std::mutex> lock(inventoriesMutex_);
-    
-    auto it = personalInventories_.find(username);
-    if (it != personalInventories_.end()) {
-        return it->second.get();
-    }
-    
-    return nullptr;
+Inventory* InventoryManager::getPersonalInventory(const PersonalKey& owner) {
+    return personalInventories_.find(owner);
+}
+
+std::optional<InventorySnapshot> InventoryManager::getPersonalSnapshot(const PersonalKey& owner) {
+    // visited under the shard's lock so the inventory can't be removed while its snapshot is copied
+    std::optional<InventorySnapshot> copy;
+    personalInventories_.visit(owner, [&copy](const Inventory& inventory) {
+        copy = inventory.readSnapshot([](const InventorySnapshot& snapshot) {
+            return snapshot;
+        });
+    });
+    return copy;
 }
 
-void InventoryManager::removePersonalInventory(const std::string& username) {
-    std::lock_guard<std::mutex> lock(inventoriesMutex_);
-    personalInventories_.erase(username);
+void InventoryManager::removePersonalInventory(const PersonalKey& owner) {
+    std::unique_ptr<Inventory> inventory = personalInventories_.remove(owner);
+    if (inventory) {
+        instanceIndex_.detach(inventory.get());
+    }
 }
 
 std::shared_ptr<Inventory> InventoryManager::getSharedStash(int stashIndex) {
@@ -49,11 +56,36 @@ std::shared_ptr<Inventory> InventoryManager::getSharedStash(int stashIndex) {
     return sharedStashManager_->getSharedStash(stashIndex);
 }
 
+bool InventoryManager::isStale(const Inventory* inventory, std::optional<uint32_t> expectedVersion) {
+    return inventory && expectedVersion && inventory->getVersion() != *expectedVersion;
+}
+
+std::optional<InstanceIndex::Location> InventoryManager::findInstance(uint64_t instanceId) const {
+    return instanceIndex_.find(instanceId);
+}
+
 InventoryManager::OperationResult InventoryManager::moveItem(
     Inventory* sourceInv,
     const GridPosition& sourcePos,
     Inventory* destInv,
     const GridPosition& destPos
+) {
+    InventoryTransaction transaction;
+    OperationResult result = moveItem(transaction, sourceInv, sourcePos, destInv, destPos);
+    if (result == OperationResult::SUCCESS) {
+        transaction.commit();
+    } else {
+        transaction.abort();
+    }
+    return result;
+}
+
+InventoryManager::OperationResult InventoryManager::moveItem(
+    InventoryTransaction& transaction,
+    Inventory* sourceInv,
+    const GridPosition& sourcePos,
+    Inventory* destInv,
+    const GridPosition& destPos
 ) {
     if (!sourceInv || !destInv) {
         return OperationResult::INVALID_SOURCE;
@@ -61,102 +93,36 @@ InventoryManager::OperationResult InventoryManager::moveItem(
     
     // item source position
     const InventorySlot* sourceSlot = sourceInv->getSlot(sourcePos);
-    if (!sourceSlot || !sourceSlot->item) {
+    if (!sourceSlot) {
         return OperationResult::ITEM_NOT_FOUND;
     }
     
-    std::shared_ptr<Item> item = sourceSlot->item;
+    ItemHandle item = sourceSlot->item;
     uint32_t stackCount = sourceSlot->stackCount;
-    ItemSize itemSize = item->getSize();
-    
-    // check if source and destination overlap
-    bool sameInventory = (sourceInv == destInv);
-    bool overlaps = false;
-    if (sameInventory) {
-        int sourceEndX = sourcePos.x + itemSize.width - 1;
-        int sourceEndY = sourcePos.y + itemSize.height - 1;
-        int destEndX = destPos.x + itemSize.width - 1;
-        int destEndY = destPos.y + itemSize.height - 1;
+    uint64_t instanceId = sourceSlot->instanceId;
+    
+    // dropping onto a different stack of the same item merges into it, only the two counts change
+    const InventorySlot* destSlot = destInv->getSlot(destPos);
+    bool ontoItself = (sourceInv == destInv && sourcePos == destPos);
+    if (destSlot && !ontoItself &&
+        destSlot->item->getId() == item->getId() &&
+        destSlot->stackCount < item->getStackLimit()) {
         
-        overlaps = !(destEndX < sourcePos.x || destPos.x > sourceEndX ||
-                    destEndY < sourcePos.y || destPos.y > sourceEndY);
-    }
-    
-    // if moving within same inventory and positions overlap, remove source first 
-    // fix for when you select a bigger than 1x1 item and try to move it where the new position would overlap with the initial position
-    std::optional<InventorySlot> tempRemoved;
-    if (overlaps) {
-        tempRemoved = sourceInv->removeItem(sourcePos);
-        if (!tempRemoved) {
+        uint32_t amountToMove = transaction.mergeInto(sourceInv, sourcePos, destInv, destPos);
+        if (amountToMove == 0) {
             return OperationResult::CONCURRENT_MODIFICATION;
         }
-    }
-    
-    // check if destination can fit the item
-    if (!destInv->canPlaceItem(*item, destPos)) {
-        // restore the temporarily removed item if needed
-        if (tempRemoved) {
-            sourceInv->placeItem(item, stackCount, sourcePos);
-        }
-        
-        // merge if destination has same item
-        const InventorySlot* destSlot = destInv->getSlot(destPos);
-        if (destSlot && destSlot->item && 
-            destSlot->item->getId() == item->getId() &&
-            destSlot->stackCount < item->getStackLimit()) {
-            
-            // merge stacks - need to remove and re-add with new count
-            int availableSpace = item->getStackLimit() - destSlot->stackCount;
-            int amountToMove = std::min(static_cast<int>(stackCount), availableSpace);
-            
-            // remove source
-            auto removed = sourceInv->removeItem(sourcePos);
-            if (!removed) {
-                return OperationResult::CONCURRENT_MODIFICATION;
-            }
-            
-            // remove destination
-            auto destRemoved = destInv->removeItem(destPos);
-            if (!destRemoved) {
-                // rollback to put the source abck
-                sourceInv->placeItem(item, stackCount, sourcePos);
-                return OperationResult::CONCURRENT_MODIFICATION;
-            }
-            
-            // place merged stack at destination
-            uint32_t newDestCount = destRemoved->stackCount + amountToMove;
-            if (!destInv->placeItem(item, newDestCount, destPos)) {
-                // rollback both
-                sourceInv->placeItem(item, stackCount, sourcePos);
-                destInv->placeItem(item, destRemoved->stackCount, destPos);
-                return OperationResult::NO_SPACE;
-            }
-            
-            // if not all moved, put remainder back at source
-            uint32_t remaining = stackCount - amountToMove;
-            if (remaining > 0) {
-                sourceInv->placeItem(item, remaining, sourcePos);
-            }
-            
-            std::cout << "Merged " << amountToMove << " of " << item->getName() << std::endl;
-            return OperationResult::SUCCESS;
-        }
         
-        return OperationResult::NO_SPACE;
+        std::cout << "Merged " << amountToMove << " of " << item->getName() << std::endl;
+        return OperationResult::SUCCESS;
     }
     
-    // remove from source (if not already removed due to overlap)
-    if (!tempRemoved) {
-        tempRemoved = sourceInv->removeItem(sourcePos);
-        if (!tempRemoved) {
-            return OperationResult::CONCURRENT_MODIFICATION;
-        }
+    // lift the item first, so it can land on cells it covered itself
+    // (bigger than 1x1 items moved by less than their own size)
+    if (!transaction.remove(sourceInv, sourcePos)) {
+        return OperationResult::CONCURRENT_MODIFICATION;
     }
-    
-    // place at destination
-    if (!destInv->placeItem(item, stackCount, destPos)) {
-        // rollback: put it back in source
-        sourceInv->placeItem(item, stackCount, sourcePos);
+    if (!transaction.place(destInv, item, stackCount, destPos, instanceId)) {
         return OperationResult::NO_SPACE;
     }
     
@@ -172,6 +138,23 @@ InventoryManager::OperationResult InventoryManager::splitStack(
     const GridPosition& pos,
     int amount,
     const GridPosition& destPos
+) {
+    InventoryTransaction transaction;
+    OperationResult result = splitStack(transaction, inventory, pos, amount, destPos);
+    if (result == OperationResult::SUCCESS) {
+        transaction.commit();
+    } else {
+        transaction.abort();
+    }
+    return result;
+}
+
+InventoryManager::OperationResult InventoryManager::splitStack(
+    InventoryTransaction& transaction,
+    Inventory* inventory,
+    const GridPosition& pos,
+    int amount,
+    const GridPosition& destPos
 ) {
     if (!inventory) {
         return OperationResult::INVALID_SOURCE;
@@ -183,7 +166,7 @@ InventoryManager::OperationResult InventoryManager::splitStack(
     
     // get source slot
     const InventorySlot* sourceSlot = inventory->getSlot(pos);
-    if (!sourceSlot || !sourceSlot->item) {
+    if (!sourceSlot) {
         return OperationResult::ITEM_NOT_FOUND;
     }
     
@@ -191,7 +174,7 @@ InventoryManager::OperationResult InventoryManager::splitStack(
         return OperationResult::INVALID_STACK_SIZE;
     }
     
-    std::shared_ptr<Item> item = sourceSlot->item;
+    ItemHandle item = sourceSlot->item;
     uint32_t originalCount = sourceSlot->stackCount;
     
     // check if destination can fit the split stack
@@ -199,31 +182,49 @@ InventoryManager::OperationResult InventoryManager::splitStack(
         return OperationResult::NO_SPACE;
     }
     
-    // remove original stack
-    auto removed = inventory->removeItem(pos);
-    if (!removed) {
+    // the source stays where it is, only its count shrinks
+    if (!transaction.adjustStack(inventory, pos, -amount)) {
         return OperationResult::CONCURRENT_MODIFICATION;
     }
-    
-    // place split amount at destination
-    if (!inventory->placeItem(item, amount, destPos)) {
-        // rollback
-        inventory->placeItem(item, originalCount, pos);
+    if (!transaction.place(inventory, item, amount, destPos)) {
         return OperationResult::NO_SPACE;
     }
     
-    // place remaining at source
-    uint32_t remaining = originalCount - amount;
-    if (!inventory->placeItem(item, remaining, pos)) {
-        // rollback: remove dest, restore source
-        inventory->removeItem(destPos);
-        inventory->placeItem(item, originalCount, pos);
+    std::cout << "Split " << amount << " of " << item->getName() 
+              << " from stack of " << originalCount << std::endl;
+    
+    return OperationResult::SUCCESS;
+}
+
+InventoryManager::OperationResult InventoryManager::sortInventory(Inventory* inventory) {
+    if (!inventory) {
+        return OperationResult::INVALID_SOURCE;
+    }
+    
+    // plan on a scratch grid first, so a layout that doesn't work out never touches the inventory
+    std::vector<InventoryPacker::Placement> layout;
+    if (!InventoryPacker::pack(*inventory, layout)) {
         return OperationResult::NO_SPACE;
     }
     
-    std::cout << "Split " << amount << " of " << item->getName() 
-              << " from stack of " << originalCount << std::endl;
+    if (InventoryPacker::matches(*inventory, layout)) {
+        return OperationResult::SUCCESS; // already sorted
+    }
+    
+    // the old and new origins all land in the same delta, so clients get the result in one update
+    InventoryTransaction transaction;
+    for (const auto& slot : inventory->getAllItems()) {
+        transaction.remove(inventory, slot.position);
+    }
+    for (const auto& placement : layout) {
+        if (!transaction.place(inventory, placement.item, placement.count, placement.position, placement.instanceId)) {
+            transaction.abort();
+            return OperationResult::NO_SPACE;
+        }
+    }
+    transaction.commit();
     
+    std::cout << "Sorted inventory into " << layout.size() << " stacks" << std::endl;
     return OperationResult::SUCCESS;
 }
 
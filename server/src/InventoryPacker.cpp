@@ -0,0 +1,132 @@
+#include "InventoryPacker.hpp"
+#include "FixedInventory.hpp"
+#include "DynamicInventory.hpp"
+#include <algorithm>
+#include <map>
+
+namespace inventory {
+
+namespace {
+
+struct Stack {
+    ItemHandle item;
+    uint32_t count;
+    uint64_t instanceId;
+};
+
+struct Total {
+    ItemHandle item;
+    uint32_t count;
+    std::vector<uint64_t> instanceIds;
+};
+
+// all items regrouped into as few stacks as the stack limits allow
+std::vector<Stack> mergeStacks(const Inventory& inventory) {
+    std::map<uint32_t, Total> totals;  // item id -> item, total count and the ids of its stacks
+    inventory.forEachItem([&totals](const InventorySlot& slot) {
+        Total& total = totals[slot.item->getId()];
+        total.item = slot.item;
+        total.count += slot.stackCount;
+        total.instanceIds.push_back(slot.instanceId);
+    });
+    
+    std::vector<Stack> stacks;
+    for (auto& entry : totals) {
+        Total& total = entry.second;
+        std::sort(total.instanceIds.begin(), total.instanceIds.end());  // oldest ids survive a merge
+        
+        uint32_t limit = std::max<uint32_t>(1, total.item->getStackLimit());
+        uint32_t remaining = total.count;
+        size_t next = 0;
+        while (remaining > 0) {
+            uint32_t count = std::min(remaining, limit);
+            uint64_t instanceId = next < total.instanceIds.size() ? total.instanceIds[next++] : 0;
+            stacks.push_back(Stack{total.item, count, instanceId});
+            remaining -= count;
+        }
+    }
+    return stacks;
+}
+
+// first-fit into an empty grid of the same size
+template <typename Grid>
+bool packInto(Grid& scratch, const std::vector<Stack>& stacks, std::vector<InventoryPacker::Placement>& layout) {
+    layout.clear();
+    
+    for (const auto& stack : stacks) {
+        std::optional<GridPosition> pos = scratch.findFirstFit(stack.item->getSize());
+        if (!pos || !scratch.placeItem(stack.item, stack.count, *pos, stack.instanceId)) {
+            return false;
+        }
+        layout.push_back(InventoryPacker::Placement{stack.item, stack.count, *pos, stack.instanceId});
+    }
+    return true;
+}
+
+// the game's two shapes get a compile-time sized scratch grid, anything else a dynamic one
+// (concrete types, so findFirstFit in packInto is a direct call)
+bool packInOrder(const Inventory& inventory, const std::vector<Stack>& stacks, std::vector<InventoryPacker::Placement>& layout) {
+    int width = inventory.getWidth();
+    int height = inventory.getHeight();
+    
+    if (width == PersonalInventoryGrid::WIDTH && height == PersonalInventoryGrid::HEIGHT) {
+        PersonalInventoryGrid scratch;
+        return packInto(scratch, stacks, layout);
+    }
+    if (width == StashInventoryGrid::WIDTH && height == StashInventoryGrid::HEIGHT) {
+        StashInventoryGrid scratch;
+        return packInto(scratch, stacks, layout);
+    }
+    
+    DynamicInventory scratch(width, height);
+    return packInto(scratch, stacks, layout);
+}
+
+} // namespace
+
+bool InventoryPacker::pack(const Inventory& inventory, std::vector<Placement>& layout) {
+    std::vector<Stack> stacks = mergeStacks(inventory);
+    
+    // the sort order: area, then the taller item first, then id, full stacks before the partial one
+    std::stable_sort(stacks.begin(), stacks.end(), [](const Stack& a, const Stack& b) {
+        ItemSize sa = a.item->getSize();
+        ItemSize sb = b.item->getSize();
+        if (sa.width * sa.height != sb.width * sb.height) {
+            return sa.width * sa.height > sb.width * sb.height;
+        }
+        if (sa.height != sb.height) {
+            return sa.height > sb.height;
+        }
+        if (a.item->getId() != b.item->getId()) {
+            return a.item->getId() < b.item->getId();
+        }
+        return a.count > b.count;
+    });
+    if (packInOrder(inventory, stacks, layout)) {
+        return true;
+    }
+    
+    // first-fit decreasing can paint itself into a corner where the current layout didn't,
+    // widest-first packs long rows differently and rescues most of those cases
+    std::stable_sort(stacks.begin(), stacks.end(), [](const Stack& a, const Stack& b) {
+        return a.item->getSize().width > b.item->getSize().width;
+    });
+    return packInOrder(inventory, stacks, layout);
+}
+
+bool InventoryPacker::matches(const Inventory& inventory, const std::vector<Placement>& layout) {
+    if (inventory.getItemCount() != layout.size()) {
+        return false;
+    }
+    
+    for (const auto& placement : layout) {
+        const InventorySlot* slot = inventory.getSlot(placement.position);
+        if (!slot || slot->item->getId() != placement.item->getId() || slot->stackCount != placement.count ||
+            slot->instanceId != placement.instanceId) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace inventory
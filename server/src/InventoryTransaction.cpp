@@ -0,0 +1,149 @@
+#include "InventoryTransaction.hpp"
+
+namespace inventory {
+
+InventoryTransaction::~InventoryTransaction() {
+    if (open_) {
+        abort();
+    }
+}
+
+void InventoryTransaction::touch(Inventory* inventory) {
+    for (const auto& entry : checkpoints_) {
+        if (entry.first == inventory) {
+            return;
+        }
+    }
+    checkpoints_.emplace_back(inventory, inventory->checkpoint());
+}
+
+bool InventoryTransaction::place(Inventory* inventory, ItemHandle item, uint32_t count, GridPosition pos, uint64_t instanceId) {
+    if (!open_ || !inventory || !item || !inventory->canPlaceItem(*item, pos)) {
+        return false;
+    }
+    
+    touch(inventory);
+    if (!inventory->placeItem(item, count, pos, instanceId)) {
+        return false; // count out of range, nothing was placed
+    }
+    
+    UndoEntry entry{UndoEntry::Kind::PLACED, inventory, InventorySlot()};
+    entry.slot.position = pos;
+    undoLog_.push_back(std::move(entry));
+    return true;
+}
+
+std::optional<InventorySlot> InventoryTransaction::remove(Inventory* inventory, GridPosition pos) {
+    if (!open_ || !inventory || !inventory->getSlot(pos)) {
+        return std::nullopt;
+    }
+    
+    touch(inventory);
+    std::optional<InventorySlot> removed = inventory->removeItem(pos);
+    undoLog_.push_back(UndoEntry{UndoEntry::Kind::REMOVED, inventory, *removed});
+    return removed;
+}
+
+bool InventoryTransaction::setStackCount(Inventory* inventory, GridPosition pos, uint32_t count) {
+    if (!open_ || !inventory) {
+        return false;
+    }
+    
+    const InventorySlot* slot = inventory->getSlot(pos);
+    if (!slot) {
+        return false;
+    }
+    
+    UndoEntry entry{UndoEntry::Kind::COUNT_CHANGED, inventory, *slot};
+    touch(inventory);
+    if (!inventory->setStackCount(pos, count)) {
+        return false;
+    }
+    
+    undoLog_.push_back(std::move(entry));
+    return true;
+}
+
+bool InventoryTransaction::adjustStack(Inventory* inventory, GridPosition pos, int32_t delta) {
+    if (!open_ || !inventory) {
+        return false;
+    }
+    
+    const InventorySlot* slot = inventory->getSlot(pos);
+    if (!slot) {
+        return false;
+    }
+    
+    UndoEntry entry{UndoEntry::Kind::COUNT_CHANGED, inventory, *slot};
+    touch(inventory);
+    if (!inventory->adjustStack(pos, delta)) {
+        return false;
+    }
+    
+    undoLog_.push_back(std::move(entry));
+    return true;
+}
+
+uint32_t InventoryTransaction::mergeInto(Inventory* sourceInv, GridPosition src, Inventory* destInv, GridPosition dst) {
+    if (!open_ || !sourceInv || !destInv) {
+        return 0;
+    }
+    
+    const InventorySlot* source = sourceInv->getSlot(src);
+    const InventorySlot* target = destInv->getSlot(dst);
+    if (!source || !target) {
+        return 0;
+    }
+    
+    // both stacks as they were, the source entry undoes either a count change or its removal
+    UndoEntry targetEntry{UndoEntry::Kind::COUNT_CHANGED, destInv, *target};
+    UndoEntry sourceEntry{UndoEntry::Kind::COUNT_CHANGED, sourceInv, *source};
+    touch(sourceInv);
+    touch(destInv);
+    
+    uint32_t amount = sourceInv->mergeInto(src, *destInv, dst);
+    if (amount == 0) {
+        return 0;
+    }
+    if (!sourceInv->getSlot(src)) {
+        sourceEntry.kind = UndoEntry::Kind::REMOVED;
+    }
+    
+    undoLog_.push_back(std::move(targetEntry));
+    undoLog_.push_back(std::move(sourceEntry));
+    return amount;
+}
+
+void InventoryTransaction::commit() {
+    undoLog_.clear();
+    checkpoints_.clear();
+    open_ = false;
+}
+
+void InventoryTransaction::abort() {
+    // backwards, so every inverse step runs against exactly the state its step produced
+    // (which is why none of them can fail)
+    for (auto it = undoLog_.rbegin(); it != undoLog_.rend(); ++it) {
+        switch (it->kind) {
+        case UndoEntry::Kind::PLACED:
+            it->inventory->removeItem(it->slot.position);
+            break;
+        case UndoEntry::Kind::REMOVED:
+            it->inventory->placeItem(it->slot.item, it->slot.stackCount, it->slot.position, it->slot.instanceId);
+            break;
+        case UndoEntry::Kind::COUNT_CHANGED:
+            it->inventory->setStackCount(it->slot.position, it->slot.stackCount);
+            break;
+        }
+    }
+    
+    for (const auto& entry : checkpoints_) {
+        entry.first->rollbackTo(entry.second);
+    }
+    
+    undoLog_.clear();
+    checkpoints_.clear();
+    open_ = false;
+}
+
+} // namespace inventory
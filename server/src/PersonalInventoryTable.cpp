@@ -0,0 +1,48 @@
+#include "PersonalInventoryTable.hpp"
+#include <mutex>
+
+namespace inventory {
+
+Inventory* PersonalInventoryTable::find(const PersonalKey& key) const {
+    const Shard& shard = shardFor(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.inventories.find(key);
+    return it != shard.inventories.end() ? it->second.get() : nullptr;
+}
+
+Inventory* PersonalInventoryTable::findOrCreate(const PersonalKey& key, const std::function<std::unique_ptr<Inventory>()>& create) {
+    // logged in players are the common case, don't take the shard exclusively for them
+    if (Inventory* existing = find(key)) {
+        return existing;
+    }
+
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.inventories.find(key);
+    if (it != shard.inventories.end()) {
+        return it->second.get();
+    }
+
+    std::unique_ptr<Inventory> inventory = create();
+    Inventory* ptr = inventory.get();
+    shard.inventories.emplace(key, std::move(inventory));
+    return ptr;
+}
+
+std::unique_ptr<Inventory> PersonalInventoryTable::remove(const PersonalKey& key) {
+    Shard& shard = shardFor(key);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.inventories.find(key);
+    if (it == shard.inventories.end()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<Inventory> inventory = std::move(it->second);
+    shard.inventories.erase(it);
+    return inventory;
+}
+
+} // namespace inventory
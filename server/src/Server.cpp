@@ -1,16 +1,30 @@
 #include "Server.hpp"
 #include "ClientSession.hpp"
+#include "TimerWheel.hpp"
 #include "InventoryManager.hpp"
+#include "InventoryLock.hpp"
+#include "StashActor.hpp"
+#include "WorkerPool.hpp"
 #include "ItemRegistry.hpp"
 #include "NetworkMessage.hpp"
 #include <iostream>
 #include <cstring>
 #include <vector>
 #include <map>
+#include <set>
 #include <mutex>
+#include <shared_mutex>
+#include <atomic>
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <cerrno>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <arpa/inet.h>
@@ -18,38 +32,189 @@
 namespace inventory
 {
 
+    // one epoll loop running on its own thread
+    // every reactor has its own SO_REUSEPORT listener, so the kernel spreads new connections
+    // across them and each reactor only ever reads from the sessions it accepted
+    struct Reactor
+    {
+        int index = 0;
+        int listenSocket = -1;
+        int epollFd = -1; // listen socket, client sockets and wakeFd
+        int wakeFd = -1;  // eventfd used by stop() and by other reactors to wake up epoll_wait
+        int tickFd = -1;  // timerfd driving the shared stash tick (reactor 0 only)
+        int timerFd = -1; // timerfd advancing the wheel one tick per config.timerTickMs
+        std::thread thread;
+
+        // heartbeat/timeout timers of the sessions this reactor owns, only touched on this thread
+        TimerWheel timers;
+        std::vector<TimerWheel::Expiry> expired;
+
+        // sessions with queued output, flushed once at the end of every loop pass
+        // so all frames produced for a session during one pass go out in a single syscall
+        std::mutex pendingMutex;
+        std::vector<int> pendingFlush;
+    };
+
+    namespace
+    {
+        // reactor running on the current thread (nullptr on the admin/main threads)
+        thread_local Reactor *currentReactor = nullptr;
+    }
+
     class ServerImpl
     {
     public:
-        int serverSocket = -1;
+        ServerConfig config;
+        std::vector<std::unique_ptr<Reactor>> reactors;
         std::map<int, std::unique_ptr<ClientSession>> clients; // socket -> session
+        uint64_t nextSessionId = 1;                            // under clientsMutex
         std::map<std::string, int> usernameToSocket;           // username -> socket (for active connections)
+        std::set<int> stashSubscribers[3];                     // sockets watching each shared stash
         std::mutex clientsMutex;
         std::unique_ptr<InventoryManager> inventoryManager;
 
-        ServerImpl()
+        // each shared stash is owned by its actor: every operation on it is a command run on the
+        // actor's thread, so stashes take no lock and a crowd on one stash queues up in order
+        // personal inventories are worked on by the session's reactor (or the admin thread) under
+        // an InventoryLock
+        // everybody else only reads published snapshots (Inventory::readSnapshot), without locking
+        // lock order: inventory locks (in InventoryLock's order) before clientsMutex
+        // request handlers run on the worker pool, through each session's strand (see handleClient)
+        std::unique_ptr<WorkerPool> workers;
+        std::vector<std::unique_ptr<StashActor>> stashActors; // index 0-2, invType 1-3, run on the pool too
+
+        // shared stashes changed since the last tick, set on the stash's actor
+        std::atomic<bool> stashDirty[3] = {false, false, false};
+
+        explicit ServerImpl(const ServerConfig &serverConfig) : config(serverConfig)
         {
             inventoryManager = std::make_unique<InventoryManager>();
+            workers = std::make_unique<WorkerPool>(config.workerThreads);
+
+            for (int i = 0; i < 3; ++i)
+            {
+                auto actor = std::make_unique<StashActor>(i, inventoryManager->getSharedStash(i).get(), *workers);
+
+                // without a tick a stash flushes whenever its actor runs out of work
+                if (config.stashTickMs <= 0)
+                {
+                    actor->setBatchHook([this, i]()
+                    {
+                        if (stashDirty[i].exchange(false))
+                        {
+                            flushStash(i);
+                        }
+                    });
+                }
+                stashActors.push_back(std::move(actor));
+            }
         }
 
-        void acceptClient(int serverSocket);
+        // the session a request came in on, carried along wherever the request is passed on
+        // a closed socket's number goes to the next connection right away: work for the request
+        // starts and replies go out only while the socket still holds this session, logged in as owner
+        struct Requester
+        {
+            int socket = -1;
+            uint64_t sessionId = 0;
+            PersonalKey owner;
+        };
+
+        // one move, however the client asked for it, carried along to the thread that owns it
+        struct MoveRequest
+        {
+            Requester from;
+            uint8_t sourceInvType = 0;
+            GridPosition sourcePos;
+            uint8_t destInvType = 0;
+            GridPosition destPos;
+            std::optional<uint32_t> sourceVersion;
+            std::optional<uint32_t> destVersion;
+            uint64_t instanceId = 0; // by instance: the source is looked up again wherever the move runs
+            int hops = 0;            // times it was passed on, a stack moving faster than the request can't bounce it forever
+        };
+        static constexpr int MAX_MOVE_HOPS = 3;
+
+        using InventoryOperation = std::function<InventoryManager::OperationResult(Inventory *)>;
+
+        bool openReactor(Reactor &reactor, int port);
+        void closeReactor(Reactor &reactor);
+        void runReactor(Reactor &reactor, const std::atomic<bool> &running);
+        void wakeReactor(Reactor &reactor);
+        void scheduleFlush(ClientSession &session);
+        void flushPending(Reactor &reactor);
+        void flushClient(int clientSocket);
+        uint64_t toTicks(int milliseconds) const;
+        void handleTimers(Reactor &reactor);
+        void handleIdleTimer(Reactor &reactor, const TimerWheel::Expiry &expiry);
+
+        void acceptClients(Reactor &reactor);
         void handleClient(int clientSocket);
-        std::string receiveMessage(int socket);
-        bool sendMessage(int socket, const NetworkMessage &msg);
+        void handleMessage(int clientSocket, const NetworkMessage &msg);                      // on the reactor
+        void handleRequest(int clientSocket, uint64_t sessionId, const NetworkMessage &msg); // on the session's strand
+        bool hasClient(int clientSocket);
+        ClientSession *findSession(int clientSocket);
+        // nullopt if the socket holds another session by now, or the session isn't logged in
+        std::optional<Requester> findRequester(int clientSocket, uint64_t sessionId);
+        bool isCurrent(const Requester &from);
+        bool isCurrentNoLock(const Requester &from); // caller holds clientsMutex
+        bool sendReply(const Requester &to, const NetworkMessage &msg); // dropped if the session is gone
+        bool sendMessageNoLock(int socket, const NetworkMessage &msg); // caller holds clientsMutex
+        bool sendFrameNoLock(int socket, const EncodedFrame &frame);   // caller holds clientsMutex
         void disconnectClient(int clientSocket);
         void disconnectClientNoLock(int clientSocket); // version without lock - used when same username as a already online user tries to join the server
 
         // handlers
-        void handleMoveItemRequest(int clientSocket, const NetworkMessage &msg);
-        void handleSplitStackRequest(int clientSocket, const NetworkMessage &msg);
+        void handleLoginRequest(int clientSocket, const NetworkMessage &msg);
+        void handleSubscribeRequest(const Requester &from, const NetworkMessage &msg);
+        void handleMoveItemRequest(const Requester &from, const NetworkMessage &msg);
+        void handleMoveInstanceRequest(const Requester &from, const NetworkMessage &msg);
+        void handleSplitStackRequest(const Requester &from, const NetworkMessage &msg);
+        void handleSortRequest(const Requester &from, const NetworkMessage &msg);
+
+        void handleSyncRequest(const Requester &from, const NetworkMessage &msg);
+
+        // routing work to the thread that owns the inventories involved
+        StashActor *actorFor(uint8_t invType); // nullptr for the personal inventory
+        void sendResult(const Requester &to, InventoryManager::OperationResult result);
+        bool isInstanceAt(uint64_t instanceId, const Inventory *inventory, const GridPosition &origin);
+        void runOnInventory(const Requester &from, uint8_t invType, InventoryOperation operation);
+        void runMove(MoveRequest request);
+        // stash to another stash: lift on the source's actor, place on the destination's, settle back on the source's
+        void beginHandoff(StashActor &source, const MoveRequest &request);
+        void acceptHandoff(const MoveRequest &request, const InventorySlot &slot);
+        void finishHandoff(const MoveRequest &request, const InventorySlot &slot, uint32_t accepted, InventoryManager::OperationResult result);
+
+        // InvType: 0=personal, 1-3=shared stash 0-2
+        Inventory *resolveInventory(const PersonalKey &owner, uint8_t invType);
+        static constexpr uint8_t INVALID_INV_TYPE = 0xFF;
+        uint8_t inventoryTypeOf(const PersonalKey &owner, const Inventory *inventory); // INVALID_INV_TYPE if not the user's to touch
 
         // helper to serialize inventory for sync
-        std::vector<uint8_t> serializeInventory(const Inventory *inventory);
+        static std::vector<uint8_t> serializeSnapshot(const InventorySnapshot &snapshot);
+        static void appendUint32(std::vector<uint8_t> &data, uint32_t value);
+        static void appendUint64(std::vector<uint8_t> &data, uint64_t value);
+        static uint32_t readUint32(const std::vector<uint8_t> &data, size_t offset);
+        // the optional [expectedVersion:4bytes] field some requests end with, nullopt if the client left it out
+        static std::optional<uint32_t> readExpectedVersion(const std::vector<uint8_t> &payload, size_t offset);
+        static void appendItemRecord(std::vector<uint8_t> &data, const InventorySlot &slot);
+        NetworkMessage makeInventoryUpdate(uint8_t invType, Inventory *inventory); // caller owns it (InventoryLock or the stash's actor), publishes its snapshot
+        // INVENTORY_FULL_SYNC (personal) or SHARED_STASH_UPDATE (stash) from the published snapshot, any thread
+        NetworkMessage makeFullSync(uint8_t invType, const Inventory *inventory, uint32_t &version);
+        // serialized outside clientsMutex, queued under it, see the definition; admit runs under the
+        // lock right before queueing, false sends nothing; false if the session is gone
+        static constexpr int SYNC_ATTEMPTS = 3;
+        bool sendFullSync(const Requester &to, uint8_t invType, const Inventory *inventory,
+                          const std::function<bool()> &admit = nullptr);
+        void broadcastToSubscribers(int stashIndex, const NetworkMessage &msg);
+        void markStashDirty(uint8_t invType); // on that stash's actor
+        void flushStash(int stashIndex);      // on that stash's actor
+        void flushDirtyStashes();
     };
 
-    Server::Server(int port) : port_(port), running_(false)
+    Server::Server(int port, const ServerConfig &config) : port_(port), config_(config), running_(false)
     {
-        impl_ = std::make_unique<ServerImpl>();
+        impl_ = std::make_unique<ServerImpl>(config_);
     }
 
     Server::~Server()
@@ -64,9 +229,36 @@ namespace inventory
             return;
         }
 
+        int reactorCount = config_.reactorThreads;
+        if (reactorCount <= 0)
+        {
+            reactorCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        // open every listener up front so a bind failure is reported to the caller
+        for (int i = 0; i < reactorCount; ++i)
+        {
+            auto reactor = std::make_unique<Reactor>();
+            reactor->index = i;
+            if (!impl_->openReactor(*reactor, port_))
+            {
+                impl_->closeReactor(*reactor);
+                for (auto &opened : impl_->reactors)
+                {
+                    impl_->closeReactor(*opened);
+                }
+                impl_->reactors.clear();
+                return;
+            }
+            impl_->reactors.push_back(std::move(reactor));
+        }
+
+        impl_->workers->start();
+
         running_ = true;
         serverThread_ = std::thread(&Server::run, this);
-        std::cout << "Server starting on port " << port_ << std::endl;
+        std::cout << "Server starting on port " << port_ << " with " << reactorCount << " reactor threads and "
+                  << impl_->workers->getWorkerCount() << " worker threads" << std::endl;
     }
 
     void Server::stop()
@@ -78,28 +270,54 @@ namespace inventory
 
         running_ = false;
 
+        // wake every reactor so it sees running_ == false and leaves epoll_wait
+        for (auto &reactor : impl_->reactors)
+        {
+            impl_->wakeReactor(*reactor);
+        }
+
+        if (serverThread_.joinable())
+        {
+            serverThread_.join();
+        }
+
+        // no reactor hands out work anymore: requests nobody started yet are dropped (the clients get
+        // SERVER_SHUTDOWN instead of an answer), what the stash actors already have is finished, a
+        // handoff that lifted a stack always puts it down somewhere; every actor is idle afterwards
+        // and picks up again after a restart
+        {
+            std::lock_guard<std::mutex> lock(impl_->clientsMutex);
+            for (auto &[socket, session] : impl_->clients)
+            {
+                session->getStrand()->close();
+            }
+        }
+        impl_->workers->stop();
+
         // shutdown - notify the clients
         {
             std::lock_guard<std::mutex> lock(impl_->clientsMutex);
             NetworkMessage shutdownMsg;
             shutdownMsg.type = MessageType::SERVER_SHUTDOWN;
 
+            // the reactors are gone, flush from here
+            EncodedFrame shutdownFrame = shutdownMsg.encode();
             for (auto &[socket, session] : impl_->clients)
             {
-                impl_->sendMessage(socket, shutdownMsg);
+                session->enqueue(shutdownFrame);
+                session->flush();
             }
         }
 
         // wait some time so clients receive shutdown message
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
-        // closing server socket
-        if (impl_->serverSocket >= 0)
+        // closing the listeners
+        for (auto &reactor : impl_->reactors)
         {
-            shutdown(impl_->serverSocket, SHUT_RDWR);
-            close(impl_->serverSocket);
-            impl_->serverSocket = -1;
+            impl_->closeReactor(*reactor);
         }
+        impl_->reactors.clear();
 
         // close client sockets
         {
@@ -110,11 +328,11 @@ namespace inventory
                 close(socket);
             }
             impl_->clients.clear();
-        }
-
-        if (serverThread_.joinable())
-        {
-            serverThread_.join();
+            impl_->usernameToSocket.clear();
+            for (auto &subscribers : impl_->stashSubscribers)
+            {
+                subscribers.clear();
+            }
         }
 
         std::cout << "Server stopped" << std::endl;
@@ -155,554 +373,1457 @@ namespace inventory
             return false;
         }
 
-        // try to place item in first available slot
-        for (int y = 0; y < inventory->getHeight(); ++y)
-        {
-            for (int x = 0; x < inventory->getWidth(); ++x)
-            {
-                GridPosition pos(x, y);
-                if (inventory->canPlaceItem(*item, pos))
-                {
-                    if (inventory->placeItem(item, count, pos))
-                    {
-                        std::cout << "Gave " << count << "x " << item->getName()
-                                  << " to " << username << " at (" << x << "," << y << ")" << std::endl;
+        // the player's reactor may be moving items in this inventory right now
+        InventoryLock inventoryLock({inventory});
 
-                        // send inventory update to client
-                        std::lock_guard<std::mutex> lock(impl_->clientsMutex);
-                        auto socketIt = impl_->usernameToSocket.find(username);
-                        if (socketIt != impl_->usernameToSocket.end())
-                        {
-                            NetworkMessage sync(MessageType::INVENTORY_FULL_SYNC);
-                            sync.payload = impl_->serializeInventory(inventory);
-                            impl_->sendMessage(socketIt->second, sync);
-                        }
+        // first free spot (row-major) from the inventory's free-space index
+        std::optional<GridPosition> pos = inventory->findFirstFit(item->getSize());
+        if (!pos || !inventory->placeItem(item, count, *pos))
+        {
+            std::cerr << "No space in " << username << "'s inventory for " << item->getName() << std::endl;
+            return false;
+        }
+        std::cout << "Gave " << count << "x " << item->getName()
+                  << " to " << username << " at (" << pos->x << "," << pos->y << ")" << std::endl;
+        NetworkMessage update = impl_->makeInventoryUpdate(0, inventory);
 
-                        return true;
-                    }
-                }
-            }
+        // send inventory update to client, still under the inventory's lock so personal deltas reach
+        // the owner in version order
+        std::lock_guard<std::mutex> lock(impl_->clientsMutex);
+        auto socketIt = impl_->usernameToSocket.find(username);
+        if (socketIt != impl_->usernameToSocket.end())
+        {
+            impl_->sendMessageNoLock(socketIt->second, update);
         }
 
-        std::cerr << "No space in " << username << "'s inventory for " << item->getName() << std::endl;
-        return false;
+        return true;
+    }
+
+    std::optional<InventorySnapshot> Server::getPlayerInventory(const std::string &username)
+    {
+        return impl_->inventoryManager->getPersonalSnapshot(username);
     }
 
-    Inventory *Server::getPlayerInventory(const std::string &username)
+    std::optional<int> Server::getPlayerSocket(const std::string &username) const
     {
-        return impl_->inventoryManager->getPersonalInventory(username);
+        std::lock_guard<std::mutex> lock(impl_->clientsMutex);
+        auto it = impl_->usernameToSocket.find(username);
+        if (it == impl_->usernameToSocket.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
     }
 
     void Server::run()
+    {
+        // reactor 0 runs on this thread, the others get their own
+        for (size_t i = 1; i < impl_->reactors.size(); ++i)
+        {
+            Reactor &reactor = *impl_->reactors[i];
+            reactor.thread = std::thread(&ServerImpl::runReactor, impl_.get(), std::ref(reactor), std::cref(running_));
+        }
+
+        if (!impl_->reactors.empty())
+        {
+            impl_->runReactor(*impl_->reactors[0], running_);
+        }
+
+        for (auto &reactor : impl_->reactors)
+        {
+            if (reactor->thread.joinable())
+            {
+                reactor->thread.join();
+            }
+        }
+    }
+
+    bool ServerImpl::openReactor(Reactor &reactor, int port)
     {
         // create socket
-        impl_->serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-        if (impl_->serverSocket < 0)
+        reactor.listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (reactor.listenSocket < 0)
         {
             std::cerr << "Failed to create socket" << std::endl;
-            running_ = false;
-            return;
+            return false;
         }
 
-        // set the socket to reuse address
+        // set the socket to reuse address, and let every reactor bind its own listener to the port
         int opt = 1;
-        setsockopt(impl_->serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-        // non-blocking socket
-        fcntl(impl_->serverSocket, F_SETFL, O_NONBLOCK);
+        setsockopt(reactor.listenSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+        if (setsockopt(reactor.listenSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+        {
+            std::cerr << "Failed to enable SO_REUSEPORT" << std::endl;
+            return false;
+        }
 
         // binding the socket
         sockaddr_in serverAddr{};
         serverAddr.sin_family = AF_INET;
         serverAddr.sin_addr.s_addr = INADDR_ANY;
-        serverAddr.sin_port = htons(port_);
+        serverAddr.sin_port = htons(port);
 
-        if (bind(impl_->serverSocket, (sockaddr *)&serverAddr, sizeof(serverAddr)) < 0)
+        if (bind(reactor.listenSocket, (sockaddr *)&serverAddr, sizeof(serverAddr)) < 0)
         {
-            std::cerr << "Failed to bind socket on port " << port_ << std::endl;
-            close(impl_->serverSocket);
-            running_ = false;
-            return;
+            std::cerr << "Failed to bind socket on port " << port << std::endl;
+            return false;
         }
 
         // listen for incoming connections
-        if (listen(impl_->serverSocket, 10) < 0)
+        if (listen(reactor.listenSocket, SOMAXCONN) < 0)
         {
             std::cerr << "Failed to listen on socket" << std::endl;
-            close(impl_->serverSocket);
-            running_ = false;
-            return;
+            return false;
         }
 
-        std::cout << "Server listening on port " << port_ << std::endl;
-
-        while (running_)
+        // edge-triggered reactor: we only wake up for sockets that have something to do
+        reactor.epollFd = epoll_create1(EPOLL_CLOEXEC);
+        reactor.wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (reactor.epollFd < 0 || reactor.wakeFd < 0)
         {
-            // accept new connections
-            impl_->acceptClient(impl_->serverSocket);
+            std::cerr << "Failed to create epoll instance" << std::endl;
+            return false;
+        }
 
-            // handle existing clients
-            std::vector<int> socketsToHandle;
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = reactor.listenSocket;
+        epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.listenSocket, &ev);
 
-            {
-                std::lock_guard<std::mutex> lock(impl_->clientsMutex);
-                for (auto &[socket, session] : impl_->clients)
-                {
-                    socketsToHandle.push_back(socket);
-                }
-            }
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = reactor.wakeFd;
+        epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.wakeFd, &ev);
 
-            // handle clients outside the lock
-            for (int socket : socketsToHandle)
+        // one reactor drives the shared stash tick, the others only ever mark stashes dirty
+        if (reactor.index == 0 && config.stashTickMs > 0)
+        {
+            reactor.tickFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (reactor.tickFd < 0)
             {
-                impl_->handleClient(socket);
+                std::cerr << "Failed to create stash tick timer" << std::endl;
+                return false;
             }
-            // avoid busy waiting
-            usleep(10000); // 10ms
-        }
 
-        // cleanup
-        std::lock_guard<std::mutex> lock(impl_->clientsMutex);
-        impl_->clients.clear();
-    }
+            itimerspec interval{};
+            interval.it_interval.tv_sec = config.stashTickMs / 1000;
+            interval.it_interval.tv_nsec = (config.stashTickMs % 1000) * 1000000L;
+            interval.it_value = interval.it_interval;
+            timerfd_settime(reactor.tickFd, 0, &interval, nullptr);
 
-    void ServerImpl::acceptClient(int serverSocket)
-    {
-        sockaddr_in clientAddr{};
-        socklen_t clientLen = sizeof(clientAddr);
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.fd = reactor.tickFd;
+            epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.tickFd, &ev);
+        }
 
-        int clientSocket = accept(serverSocket, (sockaddr *)&clientAddr, &clientLen);
-        if (clientSocket < 0)
+        // idle session reaper, one wheel per reactor since every session's timers live on its owner
+        if (config.heartbeatIntervalMs > 0)
         {
-            // EWOULDBLOCK or EAGAIN is expected for non-blocking sockets
-            // other errors during shutdown are also to be expected
-            return;
-        }
+            int tickMs = std::max(1, config.timerTickMs);
+            reactor.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+            if (reactor.timerFd < 0)
+            {
+                std::cerr << "Failed to create session timer" << std::endl;
+                return false;
+            }
 
-        // set client socket to non-blocking
-        fcntl(clientSocket, F_SETFL, O_NONBLOCK);
+            itimerspec interval{};
+            interval.it_interval.tv_sec = tickMs / 1000;
+            interval.it_interval.tv_nsec = (tickMs % 1000) * 1000000L;
+            interval.it_value = interval.it_interval;
+            timerfd_settime(reactor.timerFd, 0, &interval, nullptr);
 
-        std::lock_guard<std::mutex> lock(clientsMutex);
-        clients[clientSocket] = std::make_unique<ClientSession>(clientSocket);
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.fd = reactor.timerFd;
+            epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, reactor.timerFd, &ev);
+        }
 
-        std::cout << "New connection from " << inet_ntoa(clientAddr.sin_addr)
-                  << " (socket: " << clientSocket << ")" << std::endl;
+        return true;
     }
 
-    void ServerImpl::handleClient(int clientSocket)
+    void ServerImpl::closeReactor(Reactor &reactor)
     {
-        // validate if client still exists
+        if (reactor.listenSocket >= 0)
         {
-            std::lock_guard<std::mutex> lock(clientsMutex);
-            if (clients.find(clientSocket) == clients.end())
-            {
-                return;
-            }
+            shutdown(reactor.listenSocket, SHUT_RDWR);
+            close(reactor.listenSocket);
+            reactor.listenSocket = -1;
         }
-
-        std::string data = receiveMessage(clientSocket);
-        if (data.empty())
+        if (reactor.epollFd >= 0)
         {
-            return;
+            close(reactor.epollFd);
+            reactor.epollFd = -1;
         }
-
-        // parse the message
-        NetworkMessage msg = NetworkMessage::deserialize(std::vector<uint8_t>(data.begin(), data.end()));
-
-        if (msg.type == MessageType::LOGIN_REQUEST)
+        if (reactor.wakeFd >= 0)
         {
-            std::lock_guard<std::mutex> lock(clientsMutex);
-
-            // get username from payload
-            std::string username(msg.payload.begin(), msg.payload.end());
+            close(reactor.wakeFd);
+            reactor.wakeFd = -1;
+        }
+        if (reactor.tickFd >= 0)
+        {
+            close(reactor.tickFd);
+            reactor.tickFd = -1;
+        }
+        if (reactor.timerFd >= 0)
+        {
+            close(reactor.timerFd);
+            reactor.timerFd = -1;
+        }
+    }
 
-            std::cout << "Login request from socket " << clientSocket << " with username: " << username << std::endl;
+    void ServerImpl::wakeReactor(Reactor &reactor)
+    {
+        if (reactor.wakeFd >= 0)
+        {
+            uint64_t one = 1;
+            ssize_t written = write(reactor.wakeFd, &one, sizeof(one));
+            (void)written;
+        }
+    }
 
-            NetworkMessage response;
+    void ServerImpl::runReactor(Reactor &reactor, const std::atomic<bool> &running)
+    {
+        currentReactor = &reactor;
 
-            // validate the username
-            if (username.empty() || username.length() > 32)
-            {
-                response.type = MessageType::LOGIN_REJECTED;
-                response.payload.push_back(static_cast<uint8_t>(LoginResult::INVALID_USERNAME));
-                sendMessage(clientSocket, response);
-                disconnectClientNoLock(clientSocket);
-                return;
-            }
+        const int maxEvents = 256;
+        epoll_event events[maxEvents];
 
-            // is user already connected
-            bool alreadyConnected = false;
-            for (const auto &[sock, session] : clients)
+        while (running)
+        {
+            int count = epoll_wait(reactor.epollFd, events, maxEvents, -1);
+            if (count < 0)
             {
-                if (session->getUsername() == username && sock != clientSocket)
+                if (errno == EINTR)
                 {
-                    alreadyConnected = true;
-                    break;
+                    continue;
                 }
+                std::cerr << "epoll_wait failed: " << strerror(errno) << std::endl;
+                break;
             }
 
-            if (alreadyConnected)
+            for (int i = 0; i < count; ++i)
             {
-                std::cout << "Username " << username << " already connected, rejecting" << std::endl;
-                response.type = MessageType::LOGIN_REJECTED;
-                response.payload.push_back(static_cast<uint8_t>(LoginResult::USERNAME_ALREADY_CONNECTED));
-                sendMessage(clientSocket, response);
-                disconnectClientNoLock(clientSocket);
-                return;
-            }
+                int fd = events[i].data.fd;
 
-            // accept the login
-            clients[clientSocket]->setUsername(username);
-            usernameToSocket[username] = clientSocket;
+                if (fd == reactor.wakeFd)
+                {
+                    // stop() request, drain the counter and let the loop condition decide
+                    uint64_t value;
+                    while (read(reactor.wakeFd, &value, sizeof(value)) > 0)
+                    {
+                    }
+                    continue;
+                }
 
-            // get or create persistent inventory through InventoryManager
-            Inventory *inventory = inventoryManager->getOrCreatePersonalInventory(username);
-            (void)inventory;
+                if (fd == reactor.tickFd)
+                {
+                    // missed expirations are folded into this one, the delta log already holds everything
+                    uint64_t expirations;
+                    while (read(reactor.tickFd, &expirations, sizeof(expirations)) > 0)
+                    {
+                    }
+                    flushDirtyStashes();
+                    continue;
+                }
 
-            std::cout << "Login accepted for " << username << std::endl;
+                if (fd == reactor.timerFd)
+                {
+                    handleTimers(reactor);
+                    continue;
+                }
 
-            response.type = MessageType::LOGIN_RESPONSE;
-            response.payload.push_back(static_cast<uint8_t>(LoginResult::SUCCESS));
-            sendMessage(clientSocket, response);
+                if (fd == reactor.listenSocket)
+                {
+                    acceptClients(reactor);
+                    continue;
+                }
+
+                // read whatever is pending first, a peer can send data and close in the same wakeup
+                if (events[i].events & EPOLLIN)
+                {
+                    handleClient(fd);
+                }
 
-            // send inventory sync
-            NetworkMessage inventorySync;
-            inventorySync.type = MessageType::INVENTORY_FULL_SYNC;
-            inventorySync.payload = serializeInventory(inventory);
-            sendMessage(clientSocket, inventorySync);
+                // socket drained some of its send buffer, continue where the last flush stopped
+                if (events[i].events & EPOLLOUT)
+                {
+                    flushClient(fd);
+                }
 
-            // send all 3 shared stash syncs
-            for (int i = 0; i < 3; ++i)
-            {
-                auto stash = inventoryManager->getSharedStash(i);
-                if (stash)
+                if (events[i].events & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
                 {
-                    NetworkMessage stashSync(MessageType::SHARED_STASH_UPDATE);
-                    stashSync.payload.push_back(static_cast<uint8_t>(i)); // stash index
-                    auto stashData = serializeInventory(stash.get());
-                    stashSync.payload.insert(stashSync.payload.end(), stashData.begin(), stashData.end());
-                    sendMessage(clientSocket, stashSync);
+                    if (hasClient(fd))
+                    {
+                        disconnectClient(fd);
+                    }
                 }
             }
 
-            std::cout << "Sent inventory sync to " << username << std::endl;
+            flushPending(reactor);
         }
-        else if (msg.type == MessageType::DISCONNECT)
+
+        currentReactor = nullptr;
+    }
+
+    void ServerImpl::scheduleFlush(ClientSession &session)
+    {
+        if (!session.markFlushScheduled())
         {
-            disconnectClient(clientSocket);
+            return; // already waiting in the owner's pending list
         }
-        else if (msg.type == MessageType::HEARTBEAT)
+
+        Reactor &owner = *reactors[session.getReactorIndex()];
         {
-            NetworkMessage response(MessageType::HEARTBEAT);
-            sendMessage(clientSocket, response);
+            std::lock_guard<std::mutex> lock(owner.pendingMutex);
+            owner.pendingFlush.push_back(session.getSocket());
         }
-        else if (msg.type == MessageType::MOVE_ITEM_REQUEST)
+
+        // the owner flushes at the end of its current pass anyway, other threads have to wake it
+        if (currentReactor != &owner)
         {
-            handleMoveItemRequest(clientSocket, msg);
+            wakeReactor(owner);
         }
-        else if (msg.type == MessageType::SPLIT_STACK_REQUEST)
+    }
+
+    void ServerImpl::flushPending(Reactor &reactor)
+    {
+        std::vector<int> pending;
         {
-            handleSplitStackRequest(clientSocket, msg);
+            std::lock_guard<std::mutex> lock(reactor.pendingMutex);
+            pending.swap(reactor.pendingFlush);
         }
-        else if (msg.type == MessageType::SPLIT_STACK_REQUEST)
+
+        for (int clientSocket : pending)
         {
-            handleSplitStackRequest(clientSocket, msg);
+            // the socket may have been closed and reused by another reactor in the meantime
+            ClientSession *session = findSession(clientSocket);
+            if (session && session->getReactorIndex() == reactor.index)
+            {
+                session->clearFlushScheduled();
+                flushClient(clientSocket);
+            }
         }
     }
 
-    std::string ServerImpl::receiveMessage(int socket)
+    void ServerImpl::flushClient(int clientSocket)
     {
-        char buffer[4096];
-        int bytesRead = recv(socket, buffer, sizeof(buffer), 0);
-
-        if (bytesRead > 0)
+        // only called by the owning reactor
+        ClientSession *session = findSession(clientSocket);
+        if (!session)
         {
-            return std::string(buffer, bytesRead);
+            return;
         }
-        else if (bytesRead == 0)
+
+        if (session->hasOverflowed())
         {
-            disconnectClient(socket);
+            std::cerr << "Socket " << clientSocket << " is not reading (more than "
+                      << config.maxOutboundBytes << " bytes queued), dropping connection" << std::endl;
+            disconnectClient(clientSocket);
+            return;
         }
 
-        return "";
-    }
-
-    bool ServerImpl::sendMessage(int socket, const NetworkMessage &msg)
-    {
-        std::vector<uint8_t> data = msg.serialize();
-        int bytesSent = send(socket, data.data(), data.size(), 0);
-        return bytesSent == static_cast<int>(data.size());
+        // PENDING: the kernel buffer is full, EPOLLOUT brings us back here
+        if (session->flush() == ClientSession::FlushResult::FAILED)
+        {
+            disconnectClient(clientSocket);
+        }
     }
 
-    void ServerImpl::disconnectClient(int clientSocket)
+    uint64_t ServerImpl::toTicks(int milliseconds) const
     {
-        std::lock_guard<std::mutex> lock(clientsMutex);
-        disconnectClientNoLock(clientSocket);
+        uint64_t tickMs = static_cast<uint64_t>(std::max(1, config.timerTickMs));
+        return (static_cast<uint64_t>(std::max(0, milliseconds)) + tickMs - 1) / tickMs;
     }
 
-    void ServerImpl::disconnectClientNoLock(int clientSocket)
+    void ServerImpl::handleTimers(Reactor &reactor)
     {
-        // assuming the caller already holds clientsMutex
-        std::string username;
-
-        auto it = clients.find(clientSocket);
-        if (it != clients.end())
+        // a late wakeup reports several expirations, the wheel catches up tick by tick
+        uint64_t ticks = 0;
+        uint64_t expirations;
+        while (read(reactor.timerFd, &expirations, sizeof(expirations)) > 0)
         {
-            username = it->second->getUsername();
-            clients.erase(it);
+            ticks += expirations;
         }
 
-        if (!username.empty())
+        reactor.expired.clear();
+        reactor.timers.advance(ticks, reactor.expired);
+        for (const auto &expiry : reactor.expired)
         {
-            usernameToSocket.erase(username);
-            std::cout << "Client " << username << " disconnected" << std::endl;
-        }
-        else
-        {
-            std::cout << "Client (socket " << clientSocket << ") disconnected before login" << std::endl;
+            handleIdleTimer(reactor, expiry);
         }
-
-        shutdown(clientSocket, SHUT_RDWR);
-        close(clientSocket);
     }
 
-    void ServerImpl::handleMoveItemRequest(int clientSocket, const NetworkMessage &msg)
+    void ServerImpl::handleIdleTimer(Reactor &reactor, const TimerWheel::Expiry &expiry)
     {
-        // Payload format: [sourceInvType:1byte][sourceX:1byte][sourceY:1byte]
-        //                 [destInvType:1byte][destX:1byte][destY:1byte]
-        // InvType: 0=personal, 1-3=shared stash 0-2
+        // traffic doesn't touch the wheel, it only refreshes lastActivity, so the timer
+        // decides here whether the session is still fine, needs a heartbeat or is gone
+        int clientSocket = static_cast<int>(expiry.key);
 
-        if (msg.payload.size() < 6)
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        auto it = clients.find(clientSocket);
+        if (it == clients.end() || it->second->getIdleTimer() != expiry.id)
         {
-            std::cerr << "Invalid MOVE_ITEM_REQUEST payload size" << std::endl;
-            return;
+            return; // session is gone, or the socket number was reused by a newer one
         }
 
-        std::string username = clients[clientSocket]->getUsername();
-        if (username.empty())
+        ClientSession &session = *it->second;
+        auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - session.getLastActivity())
+                        .count();
+
+        if (idle >= config.sessionTimeoutMs)
         {
+            std::cout << "Socket " << clientSocket << " timed out after " << idle << " ms without traffic" << std::endl;
+            disconnectClientNoLock(clientSocket);
             return;
         }
 
-        uint8_t sourceInvType = msg.payload[0];
-        GridPosition sourcePos(msg.payload[1], msg.payload[2]);
-        uint8_t destInvType = msg.payload[3];
-        GridPosition destPos(msg.payload[4], msg.payload[5]);
-
-        // source inventory
-        Inventory *sourceInv = nullptr;
-        if (sourceInvType == 0)
+        int nextCheckMs;
+        if (idle >= config.heartbeatIntervalMs)
         {
-            sourceInv = inventoryManager->getPersonalInventory(username);
+            // quiet for a whole interval, ask the client to prove it's still there
+            sendMessageNoLock(clientSocket, NetworkMessage(MessageType::HEARTBEAT));
+            nextCheckMs = std::min<int>(config.heartbeatIntervalMs, config.sessionTimeoutMs - static_cast<int>(idle));
         }
-        else if (sourceInvType >= 1 && sourceInvType <= 3)
+        else
         {
-            auto sharedStash = inventoryManager->getSharedStash(sourceInvType - 1);
-            sourceInv = sharedStash.get();
+            nextCheckMs = config.heartbeatIntervalMs - static_cast<int>(idle);
         }
 
-        // destination inventory
-        Inventory *destInv = nullptr;
-        if (destInvType == 0)
+        session.setIdleTimer(reactor.timers.schedule(toTicks(nextCheckMs), clientSocket));
+    }
+
+    void ServerImpl::acceptClients(Reactor &reactor)
+    {
+        // edge-triggered listen socket: accept until the backlog is empty
+        while (true)
         {
-            destInv = inventoryManager->getPersonalInventory(username);
+            sockaddr_in clientAddr{};
+            socklen_t clientLen = sizeof(clientAddr);
+
+            int clientSocket = accept4(reactor.listenSocket, (sockaddr *)&clientAddr, &clientLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (clientSocket < 0)
+            {
+                // EWOULDBLOCK or EAGAIN means the backlog is drained
+                // other errors during shutdown are also to be expected
+                return;
+            }
+
+            // small request/response frames, don't let Nagle hold them back
+            int noDelay = 1;
+            setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+            {
+                std::lock_guard<std::mutex> lock(clientsMutex);
+                auto session = std::make_unique<ClientSession>(clientSocket, nextSessionId++, reactor.index, config.maxOutboundBytes);
+                session->setStrand(std::make_shared<Strand>(*workers, static_cast<size_t>(clientSocket)));
+                if (reactor.timerFd >= 0)
+                {
+                    session->setIdleTimer(reactor.timers.schedule(toTicks(config.heartbeatIntervalMs), clientSocket));
+                }
+                clients[clientSocket] = std::move(session);
+            }
+
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.fd = clientSocket;
+            if (epoll_ctl(reactor.epollFd, EPOLL_CTL_ADD, clientSocket, &ev) < 0)
+            {
+                std::cerr << "Failed to register socket " << clientSocket << " with epoll" << std::endl;
+                disconnectClient(clientSocket);
+                continue;
+            }
+
+            std::cout << "New connection from " << inet_ntoa(clientAddr.sin_addr)
+                      << " (socket: " << clientSocket << ", reactor: " << reactor.index << ")" << std::endl;
         }
-        else if (destInvType >= 1 && destInvType <= 3)
+    }
+
+    bool ServerImpl::hasClient(int clientSocket)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        return clients.find(clientSocket) != clients.end();
+    }
+
+    std::optional<ServerImpl::Requester> ServerImpl::findRequester(int clientSocket, uint64_t sessionId)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        auto it = clients.find(clientSocket);
+        if (it == clients.end() || it->second->getSessionId() != sessionId || !it->second->isAuthenticated())
         {
-            auto sharedStash = inventoryManager->getSharedStash(destInvType - 1);
-            destInv = sharedStash.get();
+            return std::nullopt;
         }
+        return Requester{clientSocket, sessionId, it->second->getPersonalKey()};
+    }
 
-        // move
-        auto result = inventoryManager->moveItem(sourceInv, sourcePos, destInv, destPos);
+    bool ServerImpl::isCurrent(const Requester &from)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        return isCurrentNoLock(from);
+    }
 
-        // send result
-        NetworkMessage response(MessageType::OPERATION_RESULT);
-        response.payload.push_back(static_cast<uint8_t>(result));
-        sendMessage(clientSocket, response);
+    bool ServerImpl::isCurrentNoLock(const Requester &from)
+    {
+        auto it = clients.find(from.socket);
+        return it != clients.end() && it->second->getSessionId() == from.sessionId &&
+               it->second->getPersonalKey() == from.owner;
+    }
+
+    bool ServerImpl::sendReply(const Requester &to, const NetworkMessage &msg)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        return isCurrentNoLock(to) && sendMessageNoLock(to.socket, msg);
+    }
+
+    ClientSession *ServerImpl::findSession(int clientSocket)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        auto it = clients.find(clientSocket);
+        return it != clients.end() ? it->second.get() : nullptr;
+    }
 
-        // when successful, send inventory update
-        if (result == InventoryManager::OperationResult::SUCCESS)
+    void ServerImpl::handleClient(int clientSocket)
+    {
+        // edge-triggered: keep reading until the socket would block or the client goes away
+        // only the owning reactor removes its sessions, so the pointer is safe until a handler disconnects it
+        while (true)
         {
-            // send personal inventory sync if it was involved
-            if (sourceInvType == 0 || destInvType == 0)
+            ClientSession *session = findSession(clientSocket);
+            if (!session)
             {
-                NetworkMessage sync(MessageType::INVENTORY_FULL_SYNC);
-                sync.payload = serializeInventory(inventoryManager->getPersonalInventory(username));
-                sendMessage(clientSocket, sync);
+                return;
             }
 
-            // broadcast shared stash update to ALL clients
-            if (sourceInvType >= 1 && sourceInvType <= 3)
+            FrameBuffer &buffer = session->getReceiveBuffer();
+            size_t space = 0;
+            uint8_t *region = buffer.writeRegion(space);
+
+            ssize_t bytesRead;
+            do
             {
-                int stashIndex = sourceInvType - 1;
-                auto stash = inventoryManager->getSharedStash(stashIndex);
-                NetworkMessage stashSync(MessageType::SHARED_STASH_UPDATE);
-                stashSync.payload.push_back(static_cast<uint8_t>(stashIndex));
-                auto stashData = serializeInventory(stash.get());
-                stashSync.payload.insert(stashSync.payload.end(), stashData.begin(), stashData.end());
+                bytesRead = recv(clientSocket, region, space, 0);
+            } while (bytesRead < 0 && errno == EINTR);
 
-                std::lock_guard<std::mutex> lock(clientsMutex);
-                for (const auto &[sock, session] : clients)
+            if (bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                return;
+            }
+            if (bytesRead <= 0)
+            {
+                disconnectClient(clientSocket);
+                return;
+            }
+
+            buffer.commit(static_cast<size_t>(bytesRead));
+            session->updateActivity();
+
+            // dispatch every complete frame, a handler may disconnect the session along the way
+            NetworkMessage msg;
+            while (true)
+            {
+                FrameBuffer::FrameResult frame = buffer.nextFrame(msg);
+                if (frame == FrameBuffer::FrameResult::INCOMPLETE)
+                {
+                    break;
+                }
+                if (frame == FrameBuffer::FrameResult::INVALID)
                 {
-                    sendMessage(sock, stashSync);
+                    std::cerr << "Oversized frame from socket " << clientSocket << ", dropping connection" << std::endl;
+                    disconnectClient(clientSocket);
+                    return;
+                }
+
+                // login, heartbeat and disconnect change the session itself and are cheap, they're
+                // handled right here; inventory requests go to the worker pool through the session's
+                // strand, in order, so a heavy one doesn't hold up this reactor's other sockets
+                // (the request remembers the session it came from, see Requester)
+                if (msg.type != MessageType::LOGIN_REQUEST && msg.type != MessageType::HEARTBEAT &&
+                    msg.type != MessageType::DISCONNECT)
+                {
+                    session->getStrand()->post([this, clientSocket, sessionId = session->getSessionId(), request = std::move(msg)]()
+                    {
+                        handleRequest(clientSocket, sessionId, request);
+                    });
+                    msg = NetworkMessage();
+                    continue;
+                }
+
+                handleMessage(clientSocket, msg);
+                if (!hasClient(clientSocket))
+                {
+                    return;
                 }
             }
-            if (destInvType >= 1 && destInvType <= 3 && destInvType != sourceInvType)
+        }
+    }
+
+    void ServerImpl::handleMessage(int clientSocket, const NetworkMessage &msg)
+    {
+        if (msg.type == MessageType::LOGIN_REQUEST)
+        {
+            handleLoginRequest(clientSocket, msg);
+        }
+        else if (msg.type == MessageType::DISCONNECT)
+        {
+            disconnectClient(clientSocket);
+        }
+        else if (msg.type == MessageType::HEARTBEAT)
+        {
+            // nothing to answer, receiving it already refreshed the session's activity
+        }
+    }
+
+    void ServerImpl::handleRequest(int clientSocket, uint64_t sessionId, const NetworkMessage &msg)
+    {
+        // every inventory request needs a logged in player, and the session that sent it
+        std::optional<Requester> from = findRequester(clientSocket, sessionId);
+        if (!from)
+        {
+            return;
+        }
+
+        if (msg.type == MessageType::MOVE_ITEM_REQUEST)
+        {
+            handleMoveItemRequest(*from, msg);
+        }
+        else if (msg.type == MessageType::MOVE_INSTANCE_REQUEST)
+        {
+            handleMoveInstanceRequest(*from, msg);
+        }
+        else if (msg.type == MessageType::SPLIT_STACK_REQUEST)
+        {
+            handleSplitStackRequest(*from, msg);
+        }
+        else if (msg.type == MessageType::SYNC_REQUEST)
+        {
+            handleSyncRequest(*from, msg);
+        }
+        else if (msg.type == MessageType::SORT_INVENTORY)
+        {
+            handleSortRequest(*from, msg);
+        }
+        else if (msg.type == MessageType::SUBSCRIBE_STASH || msg.type == MessageType::UNSUBSCRIBE_STASH)
+        {
+            handleSubscribeRequest(*from, msg);
+        }
+    }
+
+    bool ServerImpl::sendMessageNoLock(int socket, const NetworkMessage &msg)
+    {
+        return sendFrameNoLock(socket, msg.encode());
+    }
+
+    bool ServerImpl::sendFrameNoLock(int socket, const EncodedFrame &frame)
+    {
+        // assuming the caller already holds clientsMutex, which keeps the session alive
+        auto it = clients.find(socket);
+        if (it == clients.end())
+        {
+            return false;
+        }
+
+        // queued here, written by the owning reactor at the end of its pass
+        bool queued = it->second->enqueue(frame);
+        scheduleFlush(*it->second);
+        return queued;
+    }
+
+    void ServerImpl::disconnectClient(int clientSocket)
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        disconnectClientNoLock(clientSocket);
+    }
+
+    void ServerImpl::disconnectClientNoLock(int clientSocket)
+    {
+        // assuming the caller already holds clientsMutex
+        std::string username;
+        int epollFd = -1;
+
+        auto it = clients.find(clientSocket);
+        if (it != clients.end())
+        {
+            // best effort for whatever is still queued (e.g. a LOGIN_REJECTED right before the disconnect)
+            it->second->flush();
+
+            // requests still waiting for a worker are dropped, nobody is left to answer; whatever
+            // already went on to a stash's actor carries the session id and its reply goes nowhere
+            it->second->getStrand()->close();
+
+            username = it->second->getUsername();
+            Reactor &owner = *reactors[it->second->getReactorIndex()];
+            epollFd = owner.epollFd;
+
+            // the wheel belongs to the owner, anywhere else the timer just fires stale and is ignored
+            if (currentReactor == &owner)
             {
-                int stashIndex = destInvType - 1;
-                auto stash = inventoryManager->getSharedStash(stashIndex);
-                NetworkMessage stashSync(MessageType::SHARED_STASH_UPDATE);
-                stashSync.payload.push_back(static_cast<uint8_t>(stashIndex));
-                auto stashData = serializeInventory(stash.get());
-                stashSync.payload.insert(stashSync.payload.end(), stashData.begin(), stashData.end());
+                owner.timers.cancel(it->second->getIdleTimer());
+            }
+            clients.erase(it);
+        }
 
-                // broadcast to all connected clients
-                std::lock_guard<std::mutex> lock(clientsMutex);
-                for (const auto &[sock, session] : clients)
+        for (auto &subscribers : stashSubscribers)
+        {
+            subscribers.erase(clientSocket);
+        }
+
+        if (!username.empty())
+        {
+            usernameToSocket.erase(username);
+            std::cout << "Client " << username << " disconnected" << std::endl;
+        }
+        else
+        {
+            std::cout << "Client (socket " << clientSocket << ") disconnected before login" << std::endl;
+        }
+
+        if (epollFd >= 0)
+        {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, clientSocket, nullptr);
+        }
+        shutdown(clientSocket, SHUT_RDWR);
+        close(clientSocket);
+    }
+
+    NetworkMessage ServerImpl::makeFullSync(uint8_t invType, const Inventory *inventory, uint32_t &version)
+    {
+        // personal: [sync], stash: [stashIndex:1byte][sync], sync as in serializeSnapshot
+        NetworkMessage sync(invType == 0 ? MessageType::INVENTORY_FULL_SYNC : MessageType::SHARED_STASH_UPDATE);
+        if (invType != 0)
+        {
+            sync.payload.push_back(static_cast<uint8_t>(invType - 1));
+        }
+
+        inventory->readSnapshot([&sync, &version](const InventorySnapshot &snapshot)
+        {
+            version = snapshot.version;
+            std::vector<uint8_t> data = serializeSnapshot(snapshot);
+            sync.payload.insert(sync.payload.end(), data.begin(), data.end());
+        });
+        return sync;
+    }
+
+    bool ServerImpl::sendFullSync(const Requester &to, uint8_t invType, const Inventory *inventory,
+                                  const std::function<bool()> &admit)
+    {
+        // the client must never get a full sync older than a delta it already has: writers publish
+        // before they send a delta, so a sync is safe to queue as long as nothing newer was published
+        // since it was read; the check and the queueing happen under clientsMutex, which sending a delta
+        // takes too
+        // serializing is the slow part and stays outside the lock, a sync overtaken by a publish is read
+        // again; an inventory that keeps changing gets its last try read under the lock
+        for (int attempt = 1;; ++attempt)
+        {
+            uint32_t version = 0;
+            NetworkMessage sync;
+            bool lastAttempt = attempt >= SYNC_ATTEMPTS;
+            if (!lastAttempt)
+            {
+                sync = makeFullSync(invType, inventory, version);
+            }
+
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (!isCurrentNoLock(to))
+            {
+                return false;
+            }
+            if (lastAttempt)
+            {
+                sync = makeFullSync(invType, inventory, version);
+            }
+            else if (inventory->getPublishedVersion() != version)
+            {
+                continue;
+            }
+
+            if (!admit || admit())
+            {
+                sendMessageNoLock(to.socket, sync);
+            }
+            return true;
+        }
+    }
+
+    void ServerImpl::broadcastToSubscribers(int stashIndex, const NetworkMessage &msg)
+    {
+        // encode once, every session queues the same buffer
+        EncodedFrame frame = msg.encode();
+
+        // sessions owned by other reactors are only touched under clientsMutex
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        for (int sock : stashSubscribers[stashIndex])
+        {
+            sendFrameNoLock(sock, frame);
+        }
+    }
+
+    void ServerImpl::markStashDirty(uint8_t invType)
+    {
+        if (invType >= 1 && invType <= 3)
+        {
+            stashDirty[invType - 1] = true;
+        }
+    }
+
+    void ServerImpl::flushStash(int stashIndex)
+    {
+        NetworkMessage update = makeInventoryUpdate(static_cast<uint8_t>(stashIndex + 1), stashActors[stashIndex]->getStash());
+        if (!update.payload.empty())
+        {
+            broadcastToSubscribers(stashIndex, update);
+        }
+    }
+
+    void ServerImpl::flushDirtyStashes()
+    {
+        // every change a stash collected since the last tick goes out as one delta,
+        // a busy stash costs one frame per subscriber per tick instead of one per operation
+        // the delta is built by the stash's actor, ahead of the commands still waiting there
+        // (a stash dirtied again before the flush runs just sends an empty delta next tick)
+        for (int i = 0; i < 3; ++i)
+        {
+            if (stashDirty[i].exchange(false))
+            {
+                stashActors[i]->postUrgent([this, i]()
+                {
+                    flushStash(i);
+                });
+            }
+        }
+    }
+
+    Inventory *ServerImpl::resolveInventory(const PersonalKey &owner, uint8_t invType)
+    {
+        // InvType: 0=personal, 1-3=shared stash 0-2
+        // stashes straight from their actors, no shared_ptr copy (and refcount traffic) per lookup
+        if (invType == 0)
+        {
+            return inventoryManager->getPersonalInventory(owner);
+        }
+        StashActor *actor = actorFor(invType);
+        return actor ? actor->getStash() : nullptr;
+    }
+
+    uint8_t ServerImpl::inventoryTypeOf(const PersonalKey &owner, const Inventory *inventory)
+    {
+        if (!inventory)
+        {
+            return INVALID_INV_TYPE;
+        }
+        for (uint8_t invType = 1; invType <= 3; ++invType)
+        {
+            if (actorFor(invType)->getStash() == inventory)
+            {
+                return invType;
+            }
+        }
+        if (inventoryManager->getPersonalInventory(owner) == inventory)
+        {
+            return 0;
+        }
+        return INVALID_INV_TYPE; // someone else's personal inventory
+    }
+
+    NetworkMessage ServerImpl::makeInventoryUpdate(uint8_t invType, Inventory *inventory)
+    {
+        // Payload format: [invType:1byte][baseVersion:4bytes][version:4bytes][changeCount:2bytes]
+        // For each change: [op:1byte][x:1byte][y:1byte] + item record (see appendItemRecord) when op is 1 (set)
+        // op 0 clears the origin at x,y
+        NetworkMessage update(MessageType::INVENTORY_UPDATE);
+        if (!inventory)
+        {
+            return update;
+        }
+
+        // the change is done: readers get it before any client hears about it, so a full sync read
+        // from the snapshot is never older than a delta already sent (see handleSyncRequest)
+        inventory->publishSnapshot();
+
+        InventoryDelta delta = inventory->takeDelta();
+        if (delta.empty())
+        {
+            return update;
+        }
+
+        std::vector<uint8_t> &data = update.payload;
+        data.push_back(invType);
+        appendUint32(data, delta.baseVersion);
+        appendUint32(data, delta.version);
+
+        uint16_t changeCount = static_cast<uint16_t>(delta.changedOrigins.size());
+        data.push_back((changeCount >> 8) & 0xFF);
+        data.push_back(changeCount & 0xFF);
+
+        for (const auto &pos : delta.changedOrigins)
+        {
+            const InventorySlot *slot = inventory->getSlot(pos);
+            bool isOrigin = slot && !slot->isEmpty();
+
+            data.push_back(isOrigin ? 1 : 0);
+            data.push_back(static_cast<uint8_t>(pos.x));
+            data.push_back(static_cast<uint8_t>(pos.y));
+            if (isOrigin)
+            {
+                appendItemRecord(data, *slot);
+            }
+        }
+
+        return update;
+    }
+
+    void ServerImpl::handleLoginRequest(int clientSocket, const NetworkMessage &msg)
+    {
+        // get username from payload
+        std::string username(msg.payload.begin(), msg.payload.end());
+
+        std::cout << "Login request from socket " << clientSocket << " with username: " << username << std::endl;
+
+        Inventory *inventory = nullptr;
+        Requester from;
+        std::shared_ptr<Strand> strand;
+        {
+            std::lock_guard<std::mutex> lock(clientsMutex);
+
+            NetworkMessage response;
+
+            // validate the username
+            if (username.empty() || username.length() > 32)
+            {
+                response.type = MessageType::LOGIN_REJECTED;
+                response.payload.push_back(static_cast<uint8_t>(LoginResult::INVALID_USERNAME));
+                sendMessageNoLock(clientSocket, response);
+                disconnectClientNoLock(clientSocket);
+                return;
+            }
+
+            // is user already connected
+            bool alreadyConnected = false;
+            for (const auto &[sock, session] : clients)
+            {
+                if (session->getUsername() == username && sock != clientSocket)
                 {
-                    sendMessage(sock, stashSync);
+                    alreadyConnected = true;
+                    break;
                 }
             }
+
+            if (alreadyConnected)
+            {
+                std::cout << "Username " << username << " already connected, rejecting" << std::endl;
+                response.type = MessageType::LOGIN_REJECTED;
+                response.payload.push_back(static_cast<uint8_t>(LoginResult::USERNAME_ALREADY_CONNECTED));
+                sendMessageNoLock(clientSocket, response);
+                disconnectClientNoLock(clientSocket);
+                return;
+            }
+
+            // accept the login, from now on the session's requests prefer the worker its player's key picks
+            clients[clientSocket]->setUsername(username);
+            clients[clientSocket]->getStrand()->setAffinity(clients[clientSocket]->getPersonalKey().hash);
+            usernameToSocket[username] = clientSocket;
+
+            // get or create persistent inventory through InventoryManager
+            inventory = inventoryManager->getOrCreatePersonalInventory(clients[clientSocket]->getPersonalKey());
+            from = Requester{clientSocket, clients[clientSocket]->getSessionId(), clients[clientSocket]->getPersonalKey()};
+            strand = clients[clientSocket]->getStrand();
+
+            std::cout << "Login accepted for " << username << std::endl;
+
+            response.type = MessageType::LOGIN_RESPONSE;
+            response.payload.push_back(static_cast<uint8_t>(LoginResult::SUCCESS));
+            sendMessageNoLock(clientSocket, response);
         }
+
+        // send inventory sync, shared stashes are synced when the client subscribes to them
+        // serializing it is as heavy as any sync request, so it runs on the session's strand too, and
+        // ahead of every request the client sends after its login
+        strand->post([this, from, inventory, username]()
+        {
+            if (sendFullSync(from, 0, inventory))
+            {
+                std::cout << "Sent inventory sync to " << username << std::endl;
+            }
+        });
     }
 
-    void ServerImpl::handleSplitStackRequest(int clientSocket, const NetworkMessage &msg)
+    void ServerImpl::handleSubscribeRequest(const Requester &from, const NetworkMessage &msg)
     {
-        // Payload format: [invType:1byte][sourceX:1byte][sourceY:1byte]
-        //                 [amount:4bytes][destX:1byte][destY:1byte]
+        // Payload format: [stashIndex:1byte]
+        if (msg.payload.empty() || msg.payload[0] > 2)
+        {
+            std::cerr << "Invalid stash subscription payload" << std::endl;
+            return;
+        }
+
+        int stashIndex = msg.payload[0];
 
-        if (msg.payload.size() < 8)
+        if (msg.type == MessageType::UNSUBSCRIBE_STASH)
         {
-            std::cerr << "Invalid SPLIT_STACK_REQUEST payload size" << std::endl;
+            std::lock_guard<std::mutex> lock(clientsMutex);
+            if (isCurrentNoLock(from))
+            {
+                stashSubscribers[stashIndex].erase(from.socket);
+            }
             return;
         }
 
-        std::string username = clients[clientSocket]->getUsername();
-        if (username.empty())
+        // the subscription goes in together with the snapshot, under clientsMutex, broadcasts take it
+        // too: every delta sent after the snapshot is newer than it or stale for the client, never a gap
+        // (a client already subscribed gets nothing)
+        sendFullSync(from, static_cast<uint8_t>(stashIndex + 1), stashActors[stashIndex]->getStash(), [this, stashIndex, &from]()
         {
+            return stashSubscribers[stashIndex].insert(from.socket).second;
+        });
+    }
+
+    void ServerImpl::handleSyncRequest(const Requester &from, const NetworkMessage &msg)
+    {
+        // Payload format: [invType:1byte]
+        if (msg.payload.empty())
+        {
+            std::cerr << "Invalid SYNC_REQUEST payload size" << std::endl;
             return;
         }
 
         uint8_t invType = msg.payload[0];
-        GridPosition sourcePos(msg.payload[1], msg.payload[2]);
+        std::cout << "Resync of inventory " << static_cast<int>(invType) << " for " << from.owner.username << std::endl;
 
-        uint32_t amount = (static_cast<uint32_t>(msg.payload[3]) << 24) |
-                          (static_cast<uint32_t>(msg.payload[4]) << 16) |
-                          (static_cast<uint32_t>(msg.payload[5]) << 8) |
-                          static_cast<uint32_t>(msg.payload[6]);
+        Inventory *inventory = resolveInventory(from.owner, invType);
+        if (!inventory)
+        {
+            return;
+        }
 
-        GridPosition destPos(msg.payload[7], msg.payload[8]);
+        // no inventory lock and no trip to the stash's actor, the published snapshot is read while the
+        // owner may be in the middle of an operation (see sendFullSync for how it stays ordered with deltas)
+        sendFullSync(from, invType, inventory);
+    }
 
-        // source inventory
-        Inventory *inventory = nullptr;
-        if (invType == 0)
+    void ServerImpl::handleSortRequest(const Requester &from, const NetworkMessage &msg)
+    {
+        // Payload format: [invType:1byte]
+        if (msg.payload.empty())
         {
-            inventory = inventoryManager->getPersonalInventory(username);
+            std::cerr << "Invalid SORT_INVENTORY payload size" << std::endl;
+            return;
         }
-        else if (invType >= 1 && invType <= 3)
+
+        // the whole rearrangement goes out as a single delta (personal now, stash on the next tick)
+        InventoryManager *manager = inventoryManager.get();
+        runOnInventory(from, msg.payload[0], [manager](Inventory *inventory)
         {
-            auto sharedStash = inventoryManager->getSharedStash(invType - 1);
-            inventory = sharedStash.get();
+            return manager->sortInventory(inventory);
+        });
+    }
+
+    void ServerImpl::handleMoveItemRequest(const Requester &from, const NetworkMessage &msg)
+    {
+        // Payload format: [sourceInvType:1byte][sourceX:1byte][sourceY:1byte]
+        //                 [destInvType:1byte][destX:1byte][destY:1byte]
+        //                 optional: [sourceVersion:4bytes][destVersion:4bytes] as the client last saw them
+        // InvType: 0=personal, 1-3=shared stash 0-2
+
+        if (msg.payload.size() < 6)
+        {
+            std::cerr << "Invalid MOVE_ITEM_REQUEST payload size" << std::endl;
+            return;
         }
 
-        // split
-        auto result = inventoryManager->splitStack(inventory, sourcePos, amount, destPos);
+        MoveRequest request;
+        request.from = from;
+        request.sourceInvType = msg.payload[0];
+        request.sourcePos = GridPosition(msg.payload[1], msg.payload[2]);
+        request.destInvType = msg.payload[3];
+        request.destPos = GridPosition(msg.payload[4], msg.payload[5]);
+        request.sourceVersion = readExpectedVersion(msg.payload, 6);
+        request.destVersion = readExpectedVersion(msg.payload, 10);
+
+        runMove(std::move(request));
+    }
+
+    void ServerImpl::handleMoveInstanceRequest(const Requester &from, const NetworkMessage &msg)
+    {
+        // Payload format: [instanceId:8bytes][destInvType:1byte][destX:1byte][destY:1byte]
+        //                 optional: [destVersion:4bytes]
+        // the source is wherever the instance lies right now, not where the client last saw it,
+        // so only the destination view can be stale
+
+        if (msg.payload.size() < 11)
+        {
+            std::cerr << "Invalid MOVE_INSTANCE_REQUEST payload size" << std::endl;
+            return;
+        }
+
+        MoveRequest request;
+        request.from = from;
+        for (int i = 0; i < 8; ++i)
+        {
+            request.instanceId = (request.instanceId << 8) | msg.payload[i];
+        }
+        request.destInvType = msg.payload[8];
+        request.destPos = GridPosition(msg.payload[9], msg.payload[10]);
+        request.destVersion = readExpectedVersion(msg.payload, 11);
 
-        // send result
+        runMove(std::move(request));
+    }
+
+    void ServerImpl::handleSplitStackRequest(const Requester &from, const NetworkMessage &msg)
+    {
+        // Payload format: [invType:1byte][sourceX:1byte][sourceY:1byte]
+        //                 [amount:4bytes][destX:1byte][destY:1byte]
+        //                 optional: [version:4bytes]
+
+        if (msg.payload.size() < 9)
+        {
+            std::cerr << "Invalid SPLIT_STACK_REQUEST payload size" << std::endl;
+            return;
+        }
+
+        uint8_t invType = msg.payload[0];
+        GridPosition sourcePos(msg.payload[1], msg.payload[2]);
+
+        uint32_t amount = readUint32(msg.payload, 3);
+        GridPosition destPos(msg.payload[7], msg.payload[8]);
+        std::optional<uint32_t> expectedVersion = readExpectedVersion(msg.payload, 9);
+
+        InventoryManager *manager = inventoryManager.get();
+        runOnInventory(from, invType, [manager, sourcePos, amount, destPos, expectedVersion](Inventory *inventory)
+        {
+            if (InventoryManager::isStale(inventory, expectedVersion))
+            {
+                return InventoryManager::OperationResult::STALE_VIEW;
+            }
+            return manager->splitStack(inventory, sourcePos, amount, destPos);
+        });
+    }
+
+    StashActor *ServerImpl::actorFor(uint8_t invType)
+    {
+        if (invType >= 1 && invType <= 3)
+        {
+            return stashActors[invType - 1].get();
+        }
+        return nullptr;
+    }
+
+    void ServerImpl::sendResult(const Requester &to, InventoryManager::OperationResult result)
+    {
         NetworkMessage response(MessageType::OPERATION_RESULT);
         response.payload.push_back(static_cast<uint8_t>(result));
-        sendMessage(clientSocket, response);
+        sendReply(to, response);
+    }
 
-        // when successful, send inventory update
-        if (result == InventoryManager::OperationResult::SUCCESS)
+    bool ServerImpl::isInstanceAt(uint64_t instanceId, const Inventory *inventory, const GridPosition &origin)
+    {
+        std::optional<InstanceIndex::Location> location = inventoryManager->findInstance(instanceId);
+        return location && location->inventory == inventory && location->origin == origin;
+    }
+
+    void ServerImpl::runOnInventory(const Requester &from, uint8_t invType, InventoryOperation operation)
+    {
+        StashActor *actor = actorFor(invType);
+        if (actor && !actor->onActorThread())
         {
-            if (invType == 0)
+            actor->post([this, from, invType, operation]()
             {
-                // personal inventory
-                NetworkMessage sync(MessageType::INVENTORY_FULL_SYNC);
-                sync.payload = serializeInventory(inventoryManager->getPersonalInventory(username));
-                sendMessage(clientSocket, sync);
+                runOnInventory(from, invType, operation);
+            });
+            return;
+        }
+
+        // the player left while this waited in the actor's queue
+        if (!isCurrent(from))
+        {
+            return;
+        }
+
+        Inventory *inventory = resolveInventory(from.owner, invType);
+
+        // the stash belongs to this thread, its delta goes out with the next tick
+        if (actor)
+        {
+            InventoryManager::OperationResult result = operation(inventory);
+            markStashDirty(invType);
+            sendResult(from, result);
+            return;
+        }
+
+        // personal inventory: result and delta are sent under its lock, so the owner receives
+        // personal deltas in version order whichever thread produced them
+        InventoryLock inventoryLock({inventory});
+        sendResult(from, operation(inventory));
+
+        NetworkMessage update = makeInventoryUpdate(invType, inventory);
+        if (!update.payload.empty())
+        {
+            sendReply(from, update);
+        }
+    }
+
+    void ServerImpl::runMove(MoveRequest request)
+    {
+        using Result = InventoryManager::OperationResult;
+
+        if (request.instanceId != 0)
+        {
+            std::optional<InstanceIndex::Location> location = inventoryManager->findInstance(request.instanceId);
+            uint8_t sourceInvType = location ? inventoryTypeOf(request.from.owner, location->inventory) : INVALID_INV_TYPE;
+            if (sourceInvType == INVALID_INV_TYPE)
+            {
+                sendResult(request.from, Result::ITEM_NOT_FOUND);
+                return;
             }
-            else if (invType >= 1 && invType <= 3)  // item splitting is only being allowed inside personal inventory
-            {   
-                // shared stash - broadcast to all clients
-                int stashIndex = invType - 1;
-                auto stash = inventoryManager->getSharedStash(stashIndex);
-                NetworkMessage stashSync(MessageType::SHARED_STASH_UPDATE);
-                stashSync.payload.push_back(static_cast<uint8_t>(stashIndex));
-                auto stashData = serializeInventory(stash.get());
-                stashSync.payload.insert(stashSync.payload.end(), stashData.begin(), stashData.end());
+            request.sourceInvType = sourceInvType;
+            request.sourcePos = location->origin;
+        }
 
-                // broadcast to all connected clients
-                std::lock_guard<std::mutex> lock(clientsMutex);
-                for (const auto &[sock, session] : clients)
+        // a stash is only ever touched by its actor, the move runs on the source stash's actor,
+        // else on the destination stash's, else (personal to personal) right here
+        StashActor *owner = actorFor(request.sourceInvType);
+        if (!owner)
+        {
+            owner = actorFor(request.destInvType);
+        }
+        if (owner && !owner->onActorThread())
+        {
+            if (++request.hops > MAX_MOVE_HOPS)
+            {
+                sendResult(request.from, Result::CONCURRENT_MODIFICATION);
+                return;
+            }
+            owner->post([this, request]()
+            {
+                runMove(request);
+            });
+            return;
+        }
+
+        // the player left while this waited in the actor's queue
+        if (!isCurrent(request.from))
+        {
+            return;
+        }
+
+        // two different stashes, two owners
+        StashActor *destActor = actorFor(request.destInvType);
+        if (owner && destActor && destActor != owner)
+        {
+            beginHandoff(*owner, request);
+            return;
+        }
+
+        Inventory *sourceInv = resolveInventory(request.from.owner, request.sourceInvType);
+        Inventory *destInv = resolveInventory(request.from.owner, request.destInvType);
+        Inventory *personal = request.sourceInvType == 0 ? sourceInv : (request.destInvType == 0 ? destInv : nullptr);
+
+        bool lostTrack = false;
+        {
+            // the stash involved is ours on this thread, only the personal inventory needs its lock
+            // (result and personal delta are sent under it, see runOnInventory)
+            InventoryLock personalLock({personal});
+
+            // by instance: the stack may have moved between the lookup and getting here
+            if (request.instanceId != 0 && !isInstanceAt(request.instanceId, sourceInv, request.sourcePos))
+            {
+                lostTrack = true;
+            }
+            else
+            {
+                Result result;
+                if (InventoryManager::isStale(sourceInv, request.sourceVersion) || InventoryManager::isStale(destInv, request.destVersion))
                 {
-                    sendMessage(sock, stashSync);
+                    result = Result::STALE_VIEW;
                 }
+                else
+                {
+                    result = inventoryManager->moveItem(sourceInv, request.sourcePos, destInv, request.destPos);
+                }
+                markStashDirty(request.sourceInvType);
+                markStashDirty(request.destInvType);
+
+                sendResult(request.from, result);
+                NetworkMessage personalUpdate = makeInventoryUpdate(0, personal);
+                if (!personalUpdate.payload.empty())
+                {
+                    sendReply(request.from, personalUpdate);
+                }
+            }
+        }
+
+        if (lostTrack)
+        {
+            if (++request.hops > MAX_MOVE_HOPS)
+            {
+                sendResult(request.from, Result::CONCURRENT_MODIFICATION);
+                return;
             }
+            runMove(std::move(request));
         }
     }
 
-    std::vector<uint8_t> ServerImpl::serializeInventory(const Inventory *inventory)
+    void ServerImpl::beginHandoff(StashActor &source, const MoveRequest &request)
     {
-        std::vector<uint8_t> data;
+        // step one, on the source stash's actor: lift the stack and offer it to the destination's actor,
+        // then wait for the answer with the stack's cells kept free
+        Inventory *stash = source.getStash();
+        if (InventoryManager::isStale(stash, request.sourceVersion))
+        {
+            sendResult(request.from, InventoryManager::OperationResult::STALE_VIEW);
+            return;
+        }
 
-        if (!inventory)
+        std::optional<InventorySlot> lifted = stash->removeItem(request.sourcePos);
+        if (!lifted)
         {
-            return data;
+            sendResult(request.from, InventoryManager::OperationResult::ITEM_NOT_FOUND);
+            return;
         }
+        markStashDirty(request.sourceInvType);
+
+        source.park(lifted->position, lifted->item->getSize());
+        actorFor(request.destInvType)->postUrgent([this, request, slot = *lifted]()
+        {
+            acceptHandoff(request, slot);
+        });
+    }
+
+    void ServerImpl::acceptHandoff(const MoveRequest &request, const InventorySlot &slot)
+    {
+        // step two, on the destination stash's actor: merge or place what fits, send the rest back
+        using Result = InventoryManager::OperationResult;
 
-        // Format: [width:1byte][height:1byte][itemCount:2bytes]
-        // For each item: [x:1byte][y:1byte][itemId:4bytes][stackCount:4bytes][itemName_length:1byte][itemName:n][size_w:1byte][size_h:1byte][stackLimit:4bytes]
+        StashActor &dest = *actorFor(request.destInvType);
+        Inventory *stash = dest.getStash();
+        const InventorySlot *target = stash->getSlot(request.destPos);
 
-        data.push_back(static_cast<uint8_t>(inventory->getWidth()));
-        data.push_back(static_cast<uint8_t>(inventory->getHeight()));
+        Result result = Result::NO_SPACE;
+        uint32_t accepted = 0;
+        if (InventoryManager::isStale(stash, request.destVersion))
+        {
+            result = Result::STALE_VIEW;
+        }
+        else if (target && target->item->getId() == slot.item->getId() && target->stackCount < slot.item->getStackLimit())
+        {
+            accepted = std::min(slot.stackCount, slot.item->getStackLimit() - target->stackCount);
+            stash->adjustStack(request.destPos, static_cast<int32_t>(accepted));
+            result = Result::SUCCESS;
+        }
+        else if (dest.isReserved(request.destPos, slot.item->getSize()))
+        {
+            // this actor is waiting on a handoff of its own, those cells are promised back to it
+            result = Result::CONCURRENT_MODIFICATION;
+        }
+        else if (stash->placeItem(slot.item, slot.stackCount, request.destPos, slot.instanceId))
+        {
+            accepted = slot.stackCount;
+            result = Result::SUCCESS;
+        }
+
+        if (accepted > 0)
+        {
+            markStashDirty(request.destInvType);
+        }
+
+        actorFor(request.sourceInvType)->postUrgent([this, request, slot, accepted, result]()
+        {
+            finishHandoff(request, slot, accepted, result);
+        });
+    }
+
+    void ServerImpl::finishHandoff(const MoveRequest &request, const InventorySlot &slot, uint32_t accepted, InventoryManager::OperationResult result)
+    {
+        // step three, back on the source stash's actor: what wasn't taken goes back to the cells kept for it
+        StashActor &source = *actorFor(request.sourceInvType);
+        if (accepted < slot.stackCount)
+        {
+            source.getStash()->placeItem(slot.item, slot.stackCount - accepted, slot.position, slot.instanceId);
+            markStashDirty(request.sourceInvType);
+        }
+        source.unpark();
+
+        // the stack is settled whether or not the player is still there, only the answer may go nowhere
+        sendResult(request.from, result);
+    }
 
-        auto items = inventory->getAllItems();
-        uint16_t itemCount = static_cast<uint16_t>(items.size());
+    void ServerImpl::appendUint32(std::vector<uint8_t> &data, uint32_t value)
+    {
+        data.push_back((value >> 24) & 0xFF);
+        data.push_back((value >> 16) & 0xFF);
+        data.push_back((value >> 8) & 0xFF);
+        data.push_back(value & 0xFF);
+    }
+
+    void ServerImpl::appendUint64(std::vector<uint8_t> &data, uint64_t value)
+    {
+        appendUint32(data, static_cast<uint32_t>(value >> 32));
+        appendUint32(data, static_cast<uint32_t>(value));
+    }
+
+    uint32_t ServerImpl::readUint32(const std::vector<uint8_t> &data, size_t offset)
+    {
+        return (static_cast<uint32_t>(data[offset]) << 24) |
+               (static_cast<uint32_t>(data[offset + 1]) << 16) |
+               (static_cast<uint32_t>(data[offset + 2]) << 8) |
+               static_cast<uint32_t>(data[offset + 3]);
+    }
+
+    std::optional<uint32_t> ServerImpl::readExpectedVersion(const std::vector<uint8_t> &payload, size_t offset)
+    {
+        if (payload.size() < offset + 4)
+        {
+            return std::nullopt;
+        }
+        return readUint32(payload, offset);
+    }
+
+    void ServerImpl::appendItemRecord(std::vector<uint8_t> &data, const InventorySlot &slot)
+    {
+        // [instanceId:8bytes][itemId:4bytes][stackCount:4bytes][itemName_length:1byte][itemName:n][size_w:1byte][size_h:1byte][stackLimit:4bytes]
+
+        // instance
+        appendUint64(data, slot.instanceId);
+
+        // id
+        appendUint32(data, slot.item->getId());
+
+        // stack
+        appendUint32(data, slot.stackCount);
+
+        // name
+        const std::string &name = slot.item->getName();
+        data.push_back(static_cast<uint8_t>(name.length()));
+        data.insert(data.end(), name.begin(), name.end());
+
+        // size
+        ItemSize size = slot.item->getSize();
+        data.push_back(static_cast<uint8_t>(size.width));
+        data.push_back(static_cast<uint8_t>(size.height));
+
+        // limit
+        appendUint32(data, slot.item->getStackLimit());
+    }
+
+    std::vector<uint8_t> ServerImpl::serializeSnapshot(const InventorySnapshot &snapshot)
+    {
+        std::vector<uint8_t> data;
+
+        // Format: [width:1byte][height:1byte][version:4bytes][itemCount:2bytes]
+        // For each item: [x:1byte][y:1byte] + item record (see appendItemRecord)
+
+        data.push_back(static_cast<uint8_t>(snapshot.width));
+        data.push_back(static_cast<uint8_t>(snapshot.height));
+        appendUint32(data, snapshot.version);
+
+        uint16_t itemCount = static_cast<uint16_t>(snapshot.items.size());
         data.push_back((itemCount >> 8) & 0xFF);
         data.push_back(itemCount & 0xFF);
 
-        for (const auto &slot : items)
+        for (const InventorySlot &slot : snapshot.items)
         {
-            if (!slot.item)
-                continue;
-
             // pos
             data.push_back(static_cast<uint8_t>(slot.position.x));
             data.push_back(static_cast<uint8_t>(slot.position.y));
 
-            // id
-            uint32_t itemId = slot.item->getId();
-            data.push_back((itemId >> 24) & 0xFF);
-            data.push_back((itemId >> 16) & 0xFF);
-            data.push_back((itemId >> 8) & 0xFF);
-            data.push_back(itemId & 0xFF);
-
-            // stack
-            uint32_t stackCount = slot.stackCount;
-            data.push_back((stackCount >> 24) & 0xFF);
-            data.push_back((stackCount >> 16) & 0xFF);
-            data.push_back((stackCount >> 8) & 0xFF);
-            data.push_back(stackCount & 0xFF);
-
-            // name
-            std::string name = slot.item->getName();
-            data.push_back(static_cast<uint8_t>(name.length()));
-            data.insert(data.end(), name.begin(), name.end());
-
-            // size
-            ItemSize size = slot.item->getSize();
-            data.push_back(static_cast<uint8_t>(size.width));
-            data.push_back(static_cast<uint8_t>(size.height));
-
-            // limit
-            uint32_t stackLimit = slot.item->getStackLimit();
-            data.push_back((stackLimit >> 24) & 0xFF);
-            data.push_back((stackLimit >> 16) & 0xFF);
-            data.push_back((stackLimit >> 8) & 0xFF);
-            data.push_back(stackLimit & 0xFF);
+            appendItemRecord(data, slot);
         }
 
         return data;
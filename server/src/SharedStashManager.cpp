@@ -1,11 +1,12 @@
 #include "SharedStashManager.hpp"
+#include "FixedInventory.hpp"
 
 namespace inventory {
 
 SharedStashManager::SharedStashManager() {
     // init 3 shared stashes (12x12 each)
     for (int i = 0; i < 3; ++i) {
-        stashes_[i] = std::make_shared<Inventory>(12, 12);
+        stashes_[i] = std::make_shared<StashInventoryGrid>();
     }
 }
 
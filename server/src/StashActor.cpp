@@ -0,0 +1,67 @@
+#include "StashActor.hpp"
+
+namespace inventory {
+
+StashActor::StashActor(int stashIndex, Inventory* stash, WorkerPool& pool)
+    : index_(stashIndex),
+      stash_(stash),
+      strand_(std::make_shared<Strand>(pool, static_cast<size_t>(stashIndex))),
+      parked_(false) {
+    strand_->setBatchHook([this]() {
+        // readers on other threads see the stash as it is after the batch
+        stash_->publishSnapshot();
+        if (batchHook_) {
+            batchHook_();
+        }
+    });
+}
+
+void StashActor::post(Command command) {
+    strand_->post([this, command]() mutable {
+        dispatch(command, false);
+    });
+}
+
+void StashActor::postUrgent(Command command) {
+    strand_->post([this, command]() mutable {
+        dispatch(command, true);
+    });
+}
+
+void StashActor::dispatch(Command& command, bool urgent) {
+    if (parked_ && !urgent) {
+        deferred_.push_back(std::move(command));
+        return;
+    }
+
+    command();
+
+    // commands held back during a handoff go right after the one that ended it, they arrived earlier
+    // than anything still queued (one of them may start the next handoff)
+    while (!parked_ && !deferred_.empty()) {
+        Command next = std::move(deferred_.front());
+        deferred_.pop_front();
+        next();
+    }
+}
+
+void StashActor::park(GridPosition origin, ItemSize size) {
+    parked_ = true;
+    reservedOrigin_ = origin;
+    reservedSize_ = size;
+}
+
+void StashActor::unpark() {
+    parked_ = false;
+}
+
+bool StashActor::isReserved(GridPosition pos, ItemSize size) const {
+    if (!parked_) {
+        return false;
+    }
+
+    return pos.x < reservedOrigin_.x + reservedSize_.width && reservedOrigin_.x < pos.x + size.width &&
+           pos.y < reservedOrigin_.y + reservedSize_.height && reservedOrigin_.y < pos.y + size.height;
+}
+
+} // namespace inventory
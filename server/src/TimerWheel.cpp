@@ -0,0 +1,133 @@
+#include "TimerWheel.hpp"
+#include <algorithm>
+
+namespace inventory {
+
+TimerWheel::TimerWheel()
+    : current_(0),
+      pending_(0) {
+    std::fill(std::begin(heads_), std::end(heads_), NONE);
+}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t delayTicks, uint64_t key) {
+    int32_t index;
+    if (!freeNodes_.empty()) {
+        index = freeNodes_.back();
+        freeNodes_.pop_back();
+    } else {
+        index = static_cast<int32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+
+    Node& node = nodes_[index];
+    node.expiry = current_ + std::max<uint64_t>(delayTicks, 1);
+    node.key = key;
+    insert(index);
+    ++pending_;
+
+    return static_cast<TimerId>(index);
+}
+
+void TimerWheel::cancel(TimerId id) {
+    if (id >= nodes_.size() || nodes_[id].slot == NONE) {
+        return; // already fired or cancelled
+    }
+
+    unlink(static_cast<int32_t>(id));
+    freeNodes_.push_back(static_cast<int32_t>(id));
+    --pending_;
+}
+
+void TimerWheel::advance(uint64_t ticks, std::vector<Expiry>& expired) {
+    for (uint64_t i = 0; i < ticks; ++i) {
+        tick(expired);
+    }
+}
+
+void TimerWheel::insert(int32_t index) {
+    Node& node = nodes_[index];
+    uint64_t delta = node.expiry > current_ ? node.expiry - current_ : 0;
+
+    // the finest level whose range still covers the delay, anything past the wheel's range
+    // parks in the last slot it can reach and gets re-sorted when that slot cascades
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    uint64_t expiry = node.expiry;
+    uint64_t range = uint64_t(1) << (SLOT_BITS * LEVELS);
+    if (delta >= range) {
+        expiry = current_ + range - 1;
+    }
+
+    int32_t slot = level * SLOTS + static_cast<int32_t>((expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+    node.slot = slot;
+    node.prev = NONE;
+    node.next = heads_[slot];
+    if (node.next != NONE) {
+        nodes_[node.next].prev = index;
+    }
+    heads_[slot] = index;
+}
+
+void TimerWheel::unlink(int32_t index) {
+    Node& node = nodes_[index];
+    if (node.prev != NONE) {
+        nodes_[node.prev].next = node.next;
+    } else {
+        heads_[node.slot] = node.next;
+    }
+    if (node.next != NONE) {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = NONE;
+    node.next = NONE;
+    node.slot = NONE;
+}
+
+void TimerWheel::cascade(int level) {
+    // the coarse slot we just reached is due within the next level-below period, spread it out
+    int32_t slot = level * SLOTS + static_cast<int32_t>((current_ >> (SLOT_BITS * level)) & (SLOTS - 1));
+    int32_t index = heads_[slot];
+    heads_[slot] = NONE;
+
+    while (index != NONE) {
+        int32_t next = nodes_[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+void TimerWheel::tick(std::vector<Expiry>& expired) {
+    ++current_;
+
+    // every time a level wraps, pull the next slot of the level above down into it
+    for (int level = 1; level < LEVELS; ++level) {
+        if ((current_ & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0) {
+            break;
+        }
+        cascade(level);
+    }
+
+    int32_t slot = static_cast<int32_t>(current_ & (SLOTS - 1));
+    int32_t index = heads_[slot];
+    heads_[slot] = NONE;
+
+    while (index != NONE) {
+        Node& node = nodes_[index];
+        int32_t next = node.next;
+
+        node.prev = NONE;
+        node.next = NONE;
+        node.slot = NONE;
+        freeNodes_.push_back(index);
+        --pending_;
+        expired.push_back({static_cast<TimerId>(index), node.key});
+
+        index = next;
+    }
+}
+
+} // namespace inventory
@@ -0,0 +1,174 @@
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+namespace inventory {
+
+namespace {
+    // strand whose tasks the current thread is running (nullptr outside of one)
+    thread_local const Strand* currentStrand = nullptr;
+}
+
+WorkerPool::WorkerPool(int workerCount)
+    : running_(false),
+      queued_(0),
+      unfinished_(0),
+      sleeping_(0) {
+    if (workerCount <= 0) {
+        workerCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    for (int i = 0; i < workerCount; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start() {
+    if (running_.exchange(true)) {
+        return;
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i]->thread = std::thread(&WorkerPool::run, this, i);
+    }
+}
+
+void WorkerPool::stop() {
+    if (!running_) {
+        return;
+    }
+
+    // a queued task may be one step of several (a stash handoff that already lifted its stack, a
+    // strand's next turn), dropping it would lose the stack or leave the strand waiting forever
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        drained_.wait(lock, [this]() { return unfinished_.load() == 0; });
+        running_ = false;
+        wakeup_.notify_all();
+    }
+
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+void WorkerPool::submit(Task task, size_t affinity) {
+    Worker& worker = *workers_[affinity % workers_.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+
+    // seq_cst pair with run(): either this sees the sleeper or the sleeper sees the task
+    unfinished_.fetch_add(1);
+    queued_.fetch_add(1);
+    if (sleeping_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wakeup_.notify_one();
+    }
+}
+
+bool WorkerPool::takeTask(size_t index, Task& task) {
+    // own deque first, oldest task first
+    {
+        Worker& own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // then steal, starting with the next worker so thieves spread out
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        Worker& victim = *workers_[(index + offset) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            queued_.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::run(size_t index) {
+    Task task;
+    while (running_) {
+        if (takeTask(index, task)) {
+            task();
+            task = nullptr;
+            if (unfinished_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(sleepMutex_);
+                drained_.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleeping_.fetch_add(1);
+        wakeup_.wait(lock, [this]() { return !running_ || queued_.load() > 0; });
+        sleeping_.fetch_sub(1);
+    }
+}
+
+Strand::Strand(WorkerPool& pool, size_t affinity)
+    : pool_(pool),
+      affinity_(affinity),
+      pending_(0),
+      closed_(false) {
+}
+
+void Strand::post(Task task) {
+    queue_.push(std::move(task));
+    if (pending_.fetch_add(1) == 0) {
+        submit();
+    }
+}
+
+bool Strand::runningHere() const {
+    return currentStrand == this;
+}
+
+void Strand::submit() {
+    std::shared_ptr<Strand> self = shared_from_this();
+    pool_.submit([self]() { self->drain(); }, affinity_.load());
+}
+
+void Strand::drain() {
+    // only one drain is ever queued or running: the post that took pending_ off 0 submitted it,
+    // and it resubmits itself below while there is more
+    const Strand* previous = currentStrand;
+    currentStrand = this;
+
+    size_t batch = std::min(pending_.load(), BATCH_LIMIT);
+    Task task;
+    for (size_t i = 0; i < batch; ++i) {
+        // counted, so it's there: a post between its two steps shows up in a moment
+        while (!queue_.pop(task)) {
+            std::this_thread::yield();
+        }
+        if (!closed_) {
+            task();
+        }
+        task = nullptr;
+    }
+
+    if (batchHook_ && !closed_) {
+        batchHook_();
+    }
+    currentStrand = previous;
+
+    if (pending_.fetch_sub(batch) > batch) {
+        submit();
+    }
+}
+
+} // namespace inventory
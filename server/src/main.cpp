@@ -33,7 +33,36 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    inventory::Server server(port);
+    inventory::ServerConfig config;
+    
+    // reactor threads (0 = one per hardware thread)
+    if (argc > 2) {
+        config.reactorThreads = std::atoi(argv[2]);
+        if (config.reactorThreads < 0) {
+            std::cerr << "Invalid reactor thread count. Using one per hardware thread" << std::endl;
+            config.reactorThreads = 0;
+        }
+    }
+    
+    // shared stash tick in ms (0 = send stash changes as soon as a stash has no more work queued)
+    if (argc > 3) {
+        config.stashTickMs = std::atoi(argv[3]);
+        if (config.stashTickMs < 0) {
+            std::cerr << "Invalid stash tick. Using 0 (no batching)" << std::endl;
+            config.stashTickMs = 0;
+        }
+    }
+    
+    // worker threads (0 = one per hardware thread)
+    if (argc > 4) {
+        config.workerThreads = std::atoi(argv[4]);
+        if (config.workerThreads < 0) {
+            std::cerr << "Invalid worker thread count. Using one per hardware thread" << std::endl;
+            config.workerThreads = 0;
+        }
+    }
+    
+    inventory::Server server(port, config);
     server.start();
     
     std::cout << "Server running on port " << port << std::endl;
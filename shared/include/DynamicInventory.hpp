@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+namespace inventory {
+
+// an inventory grid of any size, for the shapes FixedInventory doesn't cover
+// struct-of-arrays grid: a row bitboard as wide as it needs to be (rowWords 64-bit words per row),
+// the owning record per cell, and per-row free runs as the free-space index
+class DynamicInventory final : public Inventory {
+public:
+    DynamicInventory(int width, int height);
+
+    FitMap getFitMap(ItemSize size) const override;
+    std::optional<GridPosition> findFirstFit(ItemSize size) const override;
+
+protected:
+    bool isAreaFree(GridPosition pos, ItemSize size) const override;
+    uint16_t getCellOwner(GridPosition pos) const override { return cellOwner_[cellIndex(pos.x, pos.y)]; }
+    void setArea(GridPosition pos, ItemSize size, uint16_t owner) override;
+    void clearGrid() override;
+
+private:
+    int rowWords_;                     // 64-bit words per bitboard row
+    std::vector<uint64_t> occupancy_;  // row bitboard, a bit is set while any item covers that cell
+    std::vector<uint16_t> cellOwner_;  // per cell, index into the records or NO_RECORD
+
+    // free-space index, kept up to date by setArea
+    std::vector<uint16_t> freeRun_;    // per cell, free cells from here to the right (0 when occupied)
+    std::vector<uint16_t> rowMaxRun_;  // per row, longest free run
+
+    const uint64_t* occupancyRow(int y) const { return &occupancy_[static_cast<size_t>(y) * rowWords_]; }
+    uint64_t* occupancyRow(int y) { return &occupancy_[static_cast<size_t>(y) * rowWords_]; }
+
+    void updateFreeRuns(int y, int firstX, int lastX);
+};
+
+} // namespace inventory
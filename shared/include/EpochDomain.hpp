@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace inventory {
+
+// epoch based reclamation for objects readers reach through an atomic pointer that writers swap
+// (Inventory snapshots): a reader pins the current epoch while it uses what it loaded, a writer
+// swaps the pointer and retires the old object, which is freed once every reader that pinned at
+// or before the swap has let go
+// readers never wait and take no lock, pinning is two stores into a slot owned by the thread
+// one domain per process
+class EpochDomain {
+public:
+    static EpochDomain& global();
+    ~EpochDomain();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // pins the epoch for its scope, nests
+    class Guard {
+    public:
+        Guard() { global().pin(); }
+        ~Guard() { global().unpin(); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // the object was already swapped out, reclaim runs once no reader can still hold it
+    // (maybe right away, maybe on a later retire)
+    void retire(std::function<void()> reclaim);
+
+    template <typename T>
+    void retire(const T* object) {
+        retire([object]() { delete object; });
+    }
+
+private:
+    static constexpr size_t MAX_READER_THREADS = 256;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> pinned{0};  // epoch its thread pinned, 0 outside any guard
+        std::atomic<bool> claimed{false};
+    };
+
+    // per thread: its slot, claimed on the first pin and handed back when the thread exits
+    struct ThreadState {
+        ReaderSlot* slot = nullptr;
+        int depth = 0;
+        ~ThreadState();
+    };
+    static thread_local ThreadState threadState_;
+
+    struct Retired {
+        uint64_t epoch;  // epoch at the swap, readers pinned at it or earlier may still hold the object
+        std::function<void()> reclaim;
+    };
+
+    std::atomic<uint64_t> epoch_{1};
+    std::array<ReaderSlot, MAX_READER_THREADS> slots_;
+    std::atomic<size_t> slotsUsed_{0};           // high water mark, collection scans only these
+    std::atomic<uint32_t> unslottedReaders_{0};  // pinned readers beyond MAX_READER_THREADS, they hold back everything
+
+    std::mutex retiredMutex_;  // writers only
+    std::vector<Retired> retired_;
+
+    EpochDomain() = default;
+
+    void pin();
+    void unpin();
+    ReaderSlot* claimSlot();
+};
+
+} // namespace inventory
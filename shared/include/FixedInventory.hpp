@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Inventory.hpp"
+#include <array>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace inventory {
+
+// an inventory whose grid shape is fixed at compile time, for the two shapes the game uses
+// (Inventory::create() hands these out for 12x5 and 12x12, DynamicInventory covers the rest)
+// one 64-bit word per row in std::array storage: every bound is a constant, a footprint test is
+// one precomputed mask per covered row and the loops over rows unroll
+// next to the words, the longest free run of every row (kept up to date by setArea), so a lookup
+// skips the bands with a row too full for the item before it ever combines their words
+template <int W, int H>
+class FixedInventory final : public Inventory {
+    static_assert(W > 0 && W <= 64, "a row has to fit in one 64-bit word");
+    static_assert(H > 0 && W * H < 0xFFFF, "cell owners are 16-bit");
+
+public:
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+
+    FixedInventory() : Inventory(W, H) { clearGrid(); }
+
+    FitMap getFitMap(ItemSize size) const override {
+        FitMap map;
+        map.width = W;
+        map.height = H;
+        map.rowWords = 1;
+        map.bits.assign(H, 0);
+
+        if (fitsInGrid(size)) {
+            for (int y = 0; y + size.height <= H; ++y) {
+                map.bits[y] = fitsInBand(size, y);
+            }
+        }
+        return map;
+    }
+
+    std::optional<GridPosition> findFirstFit(ItemSize size) const override {
+        if (!fitsInGrid(size)) {
+            return std::nullopt;
+        }
+
+        for (int y = 0; y + size.height <= H; ++y) {
+            // no band holding a row without a long enough run can fit it, the next one to try starts below that row
+            int blocked = -1;
+            for (int dy = size.height - 1; dy >= 0; --dy) {
+                if (rowMaxRun_[y + dy] < size.width) {
+                    blocked = y + dy;
+                    break;
+                }
+            }
+            if (blocked >= 0) {
+                y = blocked;
+                continue;
+            }
+
+            uint64_t fits = fitsInBand(size, y);
+            if (fits) {
+                int x = 0;
+                while (!(fits & 1)) {
+                    fits >>= 1;
+                    ++x;
+                }
+                return GridPosition(x, y);
+            }
+        }
+        return std::nullopt;
+    }
+
+protected:
+    bool isAreaFree(GridPosition pos, ItemSize size) const override {
+        if (!fitsInGrid(size) || pos.x < 0 || pos.y < 0 || pos.x + size.width > W || pos.y + size.height > H) {
+            return false;
+        }
+
+        uint64_t mask = RUN_MASKS[size.width] << pos.x;
+        for (int y = pos.y; y < pos.y + size.height; ++y) {
+            if (occupancy_[y] & mask) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint16_t getCellOwner(GridPosition pos) const override { return cellOwner_[cellIndex(pos.x, pos.y)]; }
+
+    void setArea(GridPosition pos, ItemSize size, uint16_t owner) override {
+        uint64_t mask = RUN_MASKS[size.width] << pos.x;
+        for (int y = pos.y; y < pos.y + size.height; ++y) {
+            if (owner == NO_RECORD) {
+                occupancy_[y] &= ~mask;
+            } else {
+                occupancy_[y] |= mask;
+            }
+            rowMaxRun_[y] = longestRun(~occupancy_[y] & FULL_ROW);
+            for (int x = pos.x; x < pos.x + size.width; ++x) {
+                cellOwner_[cellIndex(x, y)] = owner;
+            }
+        }
+    }
+
+    void clearGrid() override {
+        occupancy_.fill(0);
+        rowMaxRun_.fill(static_cast<uint8_t>(W));
+        cellOwner_.fill(NO_RECORD);
+    }
+
+private:
+    static constexpr uint64_t FULL_ROW = W == 64 ? ~uint64_t(0) : (uint64_t(1) << W) - 1;
+
+    // RUN_MASKS[n]: the lowest n bits set, the footprint of an n wide item placed at x = 0
+    static constexpr std::array<uint64_t, W + 1> makeRunMasks() {
+        std::array<uint64_t, W + 1> masks{};
+        for (int n = 1; n <= W; ++n) {
+            masks[n] = (masks[n - 1] << 1) | 1;
+        }
+        return masks;
+    }
+    static constexpr std::array<uint64_t, W + 1> RUN_MASKS = makeRunMasks();
+
+    std::array<uint64_t, H> occupancy_;      // bit x of row y set while an item covers (x, y)
+    std::array<uint8_t, H> rowMaxRun_;       // per row, longest free run
+    std::array<uint16_t, W * H> cellOwner_;  // per cell, index into the records or NO_RECORD
+
+    static constexpr size_t cellIndex(int x, int y) { return static_cast<size_t>(y) * W + x; }
+
+    // every step shortens each run of set bits by one, the steps it takes to clear the word are the longest run
+    static uint8_t longestRun(uint64_t bits) {
+        uint8_t length = 0;
+        while (bits) {
+            bits &= bits >> 1;
+            ++length;
+        }
+        return length;
+    }
+
+    static bool fitsInGrid(ItemSize size) {
+        return size.width > 0 && size.height > 0 && size.width <= W && size.height <= H;
+    }
+
+    // bit x set if the item fits at (x, y): OR the covered rows together, then a bit survives
+    // only if the next width - 1 cells to its right are free too
+    uint64_t fitsInBand(ItemSize size, int y) const {
+        uint64_t blocked = 0;
+        for (int row = y; row < y + size.height; ++row) {
+            blocked |= occupancy_[row];
+        }
+
+        uint64_t freeCells = ~blocked & FULL_ROW;
+        uint64_t fits = freeCells & RUN_MASKS[W - size.width + 1];  // x positions the item doesn't stick out of
+        for (int k = 1; k < size.width && fits; ++k) {
+            fits &= freeCells >> k;
+        }
+        return fits;
+    }
+};
+
+// the two shapes the game uses
+using PersonalInventoryGrid = FixedInventory<12, 5>;
+using StashInventoryGrid = FixedInventory<12, 12>;
+
+} // namespace inventory
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "Item.hpp"
+#include "ItemTable.hpp"
+#include "EpochDomain.hpp"
+#include <atomic>
 #include <vector>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 
 namespace inventory {
 
@@ -19,51 +23,215 @@ struct GridPosition {
     }
 };
 
+// one placed item, position is its top-left (origin) cell
+// instanceId follows the stack wherever it is moved (0 = none)
 struct InventorySlot {
-    std::shared_ptr<Item> item;
+    ItemHandle item;
     uint32_t stackCount;
     GridPosition position;
-    bool isOccupied;  // true when this cell is occupied by a multi-cell item (but not the origin)
+    uint64_t instanceId;
     
-    InventorySlot() : item(nullptr), stackCount(0), position(), isOccupied(false) {}
+    InventorySlot() : item(), stackCount(0), position(), instanceId(0) {}
     
-    bool isEmpty() const { return item == nullptr || stackCount == 0; }
+    bool isEmpty() const { return !item || stackCount == 0; }
 };
 
+// origins touched since the last takeDelta(), covering versions (baseVersion, version]
+// every entry describes the final state of that cell, so a receiver at any version in
+// [baseVersion, version] ends up at version after applying it
+struct InventoryDelta {
+    uint32_t baseVersion;
+    uint32_t version;
+    std::vector<GridPosition> changedOrigins;
+    
+    InventoryDelta() : baseVersion(0), version(0) {}
+    
+    bool empty() const { return changedOrigins.empty(); }
+};
+
+// where an item of one size fits, bit x of row y is set if the item can go at (x, y)
+// rows are rowWords 64-bit words wide (bit x % 64 of word x / 64), same layout as the occupancy bitboard
+struct FitMap {
+    int width;
+    int height;
+    int rowWords;
+    std::vector<uint64_t> bits;
+    
+    FitMap() : width(0), height(0), rowWords(0) {}
+    
+    bool fits(GridPosition pos) const {
+        if (pos.x < 0 || pos.x >= width || pos.y < 0 || pos.y >= height) {
+            return false;
+        }
+        return (bits[static_cast<size_t>(pos.y) * rowWords + (pos.x >> 6)] >> (pos.x & 63)) & 1;
+    }
+};
+
+// an immutable copy of an inventory at one version, what threads that don't own it get to read
+struct InventorySnapshot {
+    int width;
+    int height;
+    uint32_t version;
+    std::vector<InventorySlot> items;  // in no particular order
+    
+    InventorySnapshot() : width(0), height(0), version(0) {}
+};
+
+class Inventory;
+
+// told about every stack that lands in or leaves an inventory (InstanceIndex on the server)
+class InventoryObserver {
+public:
+    virtual ~InventoryObserver() = default;
+    virtual void onPlaced(Inventory& inventory, const InventorySlot& slot) = 0;
+    virtual void onRemoved(Inventory& inventory, const InventorySlot& slot) = 0;
+};
+
+// the inventory interface, with everything that doesn't depend on how the grid is stored: the item
+// records, versions and delta log, the observer and published snapshots
+// the grid itself (occupancy, which record covers a cell, the free-space search) is the subclass's:
+// FixedInventory<W,H> for the two shapes the game uses, DynamicInventory for any other size,
+// create() picks the one for a shape
 class Inventory {
 public:
-    Inventory(int width, int height);
+    static std::unique_ptr<Inventory> create(int width, int height);
+    
+    virtual ~Inventory();
+    
+    Inventory(const Inventory&) = delete;
+    Inventory& operator=(const Inventory&) = delete;
     
     int getWidth() const { return width_; }
     int getHeight() const { return height_; }
     
     // check if item can be placed at position
-    bool canPlaceItem(const Item& item, GridPosition pos) const;
+    bool canPlaceItem(const Item& item, GridPosition pos) const { return isAreaFree(pos, item.getSize()); }
+    
+    // every position an item of this size can be placed at, computed for the whole grid in one pass
+    virtual FitMap getFitMap(ItemSize size) const = 0;
+    
+    // first position (row-major) an item of this size fits at, answered from the grid's free-space index
+    virtual std::optional<GridPosition> findFirstFit(ItemSize size) const = 0;
+    
+    // every position an item of this size fits at, row-major (read off getFitMap)
+    std::vector<GridPosition> findAllFits(ItemSize size) const;
     
     // place item at position (returns false if can't place)
-    bool placeItem(std::shared_ptr<Item> item, uint32_t count, GridPosition pos);
+    // instanceId 0 gives the stack a fresh id, a moved stack passes its old one along
+    bool placeItem(ItemHandle item, uint32_t count, GridPosition pos, uint64_t instanceId = 0);
+    
+    // process wide unique, never 0
+    static uint64_t newInstanceId();
+    
+    void setObserver(InventoryObserver* observer) { observer_ = observer; }
+    
+    // for inventories shared between threads: held exclusive for anything that mutates (takeDelta
+    // included), the inventory never takes it itself
+    std::shared_mutex& getMutex() const { return mutex_; }
+    
+    // RCU style reads for threads that don't own the inventory (serializers, admin console): the
+    // owner publishes an immutable snapshot once an operation is done, readers get the latest one
+    // through an atomic pointer without waiting for the owner and never see half an operation
+    // publishSnapshot() is for the owner only, it copies nothing if the version didn't move
+    bool publishSnapshot();
+    
+    // read(const InventorySnapshot&) runs with the epoch pinned, the snapshot is gone after it returns
+    template <typename F>
+    auto readSnapshot(F&& read) const {
+        EpochDomain::Guard guard;
+        return read(*snapshot_.load());
+    }
+    
+    // version of the latest published snapshot, from any thread
+    uint32_t getPublishedVersion() const {
+        return readSnapshot([](const InventorySnapshot& snapshot) { return snapshot.version; });
+    }
     
     // remove item at position
     std::optional<InventorySlot> removeItem(GridPosition pos);
     
-    // get item at position (returns the top-left slot of multi-cell items)
+    // change the count of the stack whose top-left cell is pos in place (1..stack limit)
+    bool setStackCount(GridPosition pos, uint32_t count);
+    
+    // add delta (may be negative) to that stack's count, false if it would leave 1..stack limit
+    bool adjustStack(GridPosition pos, int32_t delta);
+    
+    // move as much of the stack at src onto the same item's stack at dst in dest (may be this inventory)
+    // as dst has room for, returns how many moved; only the two origin counts change, except that
+    // an emptied source is removed
+    uint32_t mergeInto(GridPosition src, Inventory& dest, GridPosition dst);
+    
+    // get the item whose top-left cell is pos
+    // (nullptr for empty cells and for the other cells covered by a multi-cell item)
     const InventorySlot* getSlot(GridPosition pos) const;
     
     // get all occupied slots
     std::vector<InventorySlot> getAllItems() const;
     
+    // visit every placed item in place (no copies, no allocation), in no particular order
+    template <typename F>
+    void forEachItem(F&& visit) const {
+        for (const auto& record : records_) {
+            visit(record);
+        }
+    }
+    
+    size_t getItemCount() const { return records_.size(); }
+    
     // clear inventory
     void clear();
     
+    // bumped on every successful mutation
+    uint32_t getVersion() const { return version_; }
+    
+    // hand out the cells changed since the last call (for INVENTORY_UPDATE) and start a new delta
+    InventoryDelta takeDelta();
+    
+    // version and change log position, for callers that undo their own mutations
+    // rollbackTo() forgets everything recorded since the checkpoint, the caller must have
+    // restored the cells already (see InventoryTransaction)
+    struct Checkpoint {
+        uint32_t version;
+        uint32_t deltaBaseVersion;
+        size_t changeCount;
+    };
+    Checkpoint checkpoint() const { return Checkpoint{version_, deltaBaseVersion_, changedOrigins_.size()}; }
+    void rollbackTo(const Checkpoint& checkpoint);
+    
+protected:
+    static constexpr uint16_t NO_RECORD = 0xFFFF;
+    
+    Inventory(int width, int height);
+    
+    // the grid, cells are indexed row-major (y * width + x)
+    // false if any cell is covered or out of bounds
+    virtual bool isAreaFree(GridPosition pos, ItemSize size) const = 0;
+    // index into the records of whatever covers the cell (pos is in bounds), or NO_RECORD
+    virtual uint16_t getCellOwner(GridPosition pos) const = 0;
+    // owner for every cell of the area (NO_RECORD frees them)
+    virtual void setArea(GridPosition pos, ItemSize size, uint16_t owner) = 0;
+    virtual void clearGrid() = 0;
+    
+    size_t cellIndex(int x, int y) const { return static_cast<size_t>(y) * width_ + x; }
+    
 private:
     int width_;
     int height_;
-    std::vector<std::vector<InventorySlot>> grid_;
     
+    std::vector<InventorySlot> records_; // placed items, densely packed in no particular order
+    InventoryObserver* observer_;
+    mutable std::shared_mutex mutex_;
+    
+    std::atomic<const InventorySnapshot*> snapshot_;  // latest published, retired through EpochDomain when replaced
+    uint32_t publishedVersion_;
+    
+    uint32_t version_;
+    uint32_t deltaBaseVersion_;
+    std::vector<bool> changed_;               // per cell, keeps changedOrigins_ free of duplicates
+    std::vector<GridPosition> changedOrigins_;
+    
+    void markChanged(GridPosition pos);
     bool isPositionValid(GridPosition pos) const;
-    bool isAreaOccupied(GridPosition pos, ItemSize size) const;
-    void occupyArea(GridPosition pos, ItemSize size, std::shared_ptr<Item> item, uint32_t count);
-    void clearArea(GridPosition pos, ItemSize size);
 };
 
 } // namespace inventory
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Item.hpp"
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+namespace inventory {
+
+class ItemHandle;
+
+// process wide, append-only table of item types, one entry per item id
+// entries never move or change once added, so resolving a handle is two array indexings,
+// no lock and no reference count (the server fills it from ItemRegistry, the client from sync data)
+class ItemTable {
+public:
+    // handle for this item's id, added on first sight (the first description of an id wins)
+    static ItemHandle intern(const Item& item);
+    
+    // handle of an already interned id, invalid if unknown
+    static ItemHandle find(uint32_t itemId);
+    
+    static const Item& get(uint32_t index) {
+        return chunks_[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+    }
+    
+    static size_t size();
+    
+private:
+    static constexpr uint32_t CHUNK_BITS = 8;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static constexpr uint32_t MAX_CHUNKS = 256;  // 65536 item types
+    
+    // chunks are allocated once and never freed or moved, only new ones are appended
+    static std::unique_ptr<Item[]> chunks_[MAX_CHUNKS];
+    static std::unordered_map<uint32_t, uint32_t> indexById_;  // guarded by mutex_
+    static uint32_t count_;                                    // guarded by mutex_
+    static std::mutex mutex_;
+};
+
+// 32-bit reference to an interned item type, cheap to copy around and to compare
+// (two handles are equal exactly when they refer to the same item id)
+class ItemHandle {
+public:
+    static constexpr uint32_t INVALID_INDEX = 0xFFFFFFFF;
+    
+    ItemHandle() : index_(INVALID_INDEX) {}
+    explicit ItemHandle(uint32_t index) : index_(index) {}
+    
+    bool isValid() const { return index_ != INVALID_INDEX; }
+    explicit operator bool() const { return isValid(); }
+    
+    uint32_t getIndex() const { return index_; }
+    
+    const Item& operator*() const { return ItemTable::get(index_); }
+    const Item* operator->() const { return &ItemTable::get(index_); }
+    
+    bool operator==(const ItemHandle& other) const { return index_ == other.index_; }
+    bool operator!=(const ItemHandle& other) const { return index_ != other.index_; }
+    
+private:
+    uint32_t index_;
+};
+
+} // namespace inventory
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <vector>
 #include <string>
+#include <memory>
 
 namespace inventory {
 
@@ -12,12 +13,17 @@ enum class MessageType : uint8_t {
     DISCONNECT = 2,
     MOVE_ITEM_REQUEST = 10,
     SPLIT_STACK_REQUEST = 11,
+    SYNC_REQUEST = 12,         // client lost track of an inventory (delta gap), asks for a full sync
+    SUBSCRIBE_STASH = 13,      // start receiving updates for one shared stash (full sync follows)
+    UNSUBSCRIBE_STASH = 14,
+    SORT_INVENTORY = 15,       // merge stacks and compact one inventory server side
+    MOVE_INSTANCE_REQUEST = 16, // move a stack named by its instance id, wherever it is now
     
     // Server to Client
     LOGIN_RESPONSE = 50,
     LOGIN_REJECTED = 51,
     INVENTORY_FULL_SYNC = 52,
-    INVENTORY_UPDATE = 53,
+    INVENTORY_UPDATE = 53,     // cell level delta for one inventory
     SHARED_STASH_UPDATE = 54,
     OPERATION_RESULT = 55,
     SERVER_SHUTDOWN = 56,
@@ -40,6 +46,10 @@ enum class InventoryType : uint8_t {
     SHARED_STASH_3 = 3
 };
 
+// a serialized message that can't change anymore
+// broadcasts encode once and every session queues the same buffer by reference
+using EncodedFrame = std::shared_ptr<const std::vector<uint8_t>>;
+
 struct NetworkMessage {
     MessageType type;
     std::vector<uint8_t> payload;
@@ -49,6 +59,7 @@ struct NetworkMessage {
     
     // serialization helpers
     std::vector<uint8_t> serialize() const;
+    EncodedFrame encode() const;
     static NetworkMessage deserialize(const std::vector<uint8_t>& data);
 };
 
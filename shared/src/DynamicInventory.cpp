@@ -0,0 +1,208 @@
+#include "DynamicInventory.hpp"
+#include <algorithm>
+
+namespace inventory {
+
+namespace {
+
+// bits [from, from + count) of one word
+uint64_t spanMask(int from, int count) {
+    uint64_t bits = count >= 64 ? ~uint64_t(0) : ((uint64_t(1) << count) - 1);
+    return bits << from;
+}
+
+// out = in >> shift across a row of several words (bit x ends up at bit x - shift)
+void shiftRowDown(const uint64_t* in, uint64_t* out, int words, int shift) {
+    int wordShift = shift >> 6;
+    int bitShift = shift & 63;
+    for (int i = 0; i < words; ++i) {
+        uint64_t low = i + wordShift < words ? in[i + wordShift] : 0;
+        uint64_t high = i + wordShift + 1 < words ? in[i + wordShift + 1] : 0;
+        out[i] = bitShift == 0 ? low : (low >> bitShift) | (high << (64 - bitShift));
+    }
+}
+
+} // namespace
+
+DynamicInventory::DynamicInventory(int width, int height)
+    : Inventory(width, height),
+      rowWords_((width + 63) / 64),
+      occupancy_(static_cast<size_t>(height) * ((width + 63) / 64), 0),
+      cellOwner_(static_cast<size_t>(width) * height, NO_RECORD),
+      freeRun_(static_cast<size_t>(width) * height),
+      rowMaxRun_(height, static_cast<uint16_t>(width)) {
+    clearGrid();
+}
+
+bool DynamicInventory::isAreaFree(GridPosition pos, ItemSize size) const {
+    // out of bounds counts as occupied
+    if (pos.x < 0 || pos.y < 0 || pos.x + size.width > getWidth() || pos.y + size.height > getHeight()) {
+        return false;
+    }
+    
+    // one AND per row and word the footprint touches (a single word for grids up to 64 wide)
+    for (int y = pos.y; y < pos.y + size.height; ++y) {
+        const uint64_t* row = occupancyRow(y);
+        for (int x = pos.x, remaining = size.width; remaining > 0;) {
+            int take = std::min(remaining, 64 - (x & 63));
+            if (row[x >> 6] & spanMask(x & 63, take)) {
+                return false;
+            }
+            x += take;
+            remaining -= take;
+        }
+    }
+    return true;
+}
+
+FitMap DynamicInventory::getFitMap(ItemSize size) const {
+    int width = getWidth();
+    int height = getHeight();
+    
+    FitMap map;
+    map.width = width;
+    map.height = height;
+    map.rowWords = rowWords_;
+    map.bits.assign(occupancy_.size(), 0);
+    
+    if (size.width <= 0 || size.height <= 0 || size.width > width || size.height > height) {
+        return map;
+    }
+    
+    // horizontal pass: bit x ends up set when cells [x, x + width) of the row are free,
+    // built by doubling the covered run so it takes log2(width) shifts per row
+    // (cells past the right edge start out occupied, so items can't hang over it)
+    std::vector<uint64_t> shifted(rowWords_);
+    for (int y = 0; y < height; ++y) {
+        uint64_t* run = &map.bits[static_cast<size_t>(y) * rowWords_];
+        const uint64_t* row = occupancyRow(y);
+        for (int i = 0; i < rowWords_; ++i) {
+            run[i] = ~row[i];
+        }
+        if (width & 63) {
+            run[rowWords_ - 1] &= spanMask(0, width & 63);
+        }
+        
+        for (int covered = 1; covered < size.width;) {
+            int step = std::min(covered, size.width - covered);
+            shiftRowDown(run, shifted.data(), rowWords_, step);
+            for (int i = 0; i < rowWords_; ++i) {
+                run[i] &= shifted[i];
+            }
+            covered += step;
+        }
+    }
+    
+    // vertical pass: the item fits at row y if its horizontal run fits in rows [y, y + height)
+    for (int y = 0; y < height; ++y) {
+        uint64_t* out = &map.bits[static_cast<size_t>(y) * rowWords_];
+        if (y + size.height > height) {
+            std::fill(out, out + rowWords_, 0);
+            continue;
+        }
+        for (int dy = 1; dy < size.height; ++dy) {
+            const uint64_t* below = &map.bits[static_cast<size_t>(y + dy) * rowWords_];
+            for (int i = 0; i < rowWords_; ++i) {
+                out[i] &= below[i];
+            }
+        }
+    }
+    
+    return map;
+}
+
+std::optional<GridPosition> DynamicInventory::findFirstFit(ItemSize size) const {
+    int width = getWidth();
+    int height = getHeight();
+    if (size.width <= 0 || size.height <= 0 || size.width > width || size.height > height) {
+        return std::nullopt;
+    }
+    uint16_t itemWidth = static_cast<uint16_t>(size.width);
+    
+    for (int y = 0; y + size.height <= height; ++y) {
+        // skip every window containing a row that has no long enough run at all
+        int blocked = -1;
+        for (int dy = size.height - 1; dy >= 0; --dy) {
+            if (rowMaxRun_[y + dy] < itemWidth) {
+                blocked = y + dy;
+                break;
+            }
+        }
+        if (blocked >= 0) {
+            y = blocked;
+            continue;
+        }
+        
+        const uint16_t* run = &freeRun_[cellIndex(0, y)];
+        for (int x = 0; x + size.width <= width;) {
+            if (run[x] < itemWidth) {
+                x += run[x] + 1; // the cell right after this run is occupied
+                continue;
+            }
+            
+            bool fits = true;
+            for (int dy = 1; dy < size.height && fits; ++dy) {
+                fits = freeRun_[cellIndex(x, y + dy)] >= itemWidth;
+            }
+            if (fits) {
+                return GridPosition(x, y);
+            }
+            ++x;
+        }
+    }
+    return std::nullopt;
+}
+
+void DynamicInventory::setArea(GridPosition pos, ItemSize size, uint16_t owner) {
+    for (int y = pos.y; y < pos.y + size.height; ++y) {
+        std::fill_n(&cellOwner_[cellIndex(pos.x, y)], size.width, owner);
+        
+        uint64_t* row = occupancyRow(y);
+        for (int x = pos.x, remaining = size.width; remaining > 0;) {
+            int take = std::min(remaining, 64 - (x & 63));
+            if (owner == NO_RECORD) {
+                row[x >> 6] &= ~spanMask(x & 63, take);
+            } else {
+                row[x >> 6] |= spanMask(x & 63, take);
+            }
+            x += take;
+            remaining -= take;
+        }
+        
+        updateFreeRuns(y, pos.x, pos.x + size.width - 1);
+    }
+}
+
+void DynamicInventory::updateFreeRuns(int y, int firstX, int lastX) {
+    // runs only change from the end of the touched span leftwards, and stop changing
+    // as soon as one left of the span comes out the same as before
+    int width = getWidth();
+    uint16_t* run = &freeRun_[cellIndex(0, y)];
+    const uint16_t* owner = &cellOwner_[cellIndex(0, y)];
+    for (int x = lastX; x >= 0; --x) {
+        uint16_t value = 0;
+        if (owner[x] == NO_RECORD) {
+            value = static_cast<uint16_t>(x + 1 < width ? run[x + 1] + 1 : 1);
+        }
+        if (x < firstX && value == run[x]) {
+            break;
+        }
+        run[x] = value;
+    }
+    
+    rowMaxRun_[y] = *std::max_element(run, run + width);
+}
+
+void DynamicInventory::clearGrid() {
+    int width = getWidth();
+    std::fill(occupancy_.begin(), occupancy_.end(), 0);
+    std::fill(cellOwner_.begin(), cellOwner_.end(), NO_RECORD);
+    for (int y = 0; y < getHeight(); ++y) {
+        for (int x = 0; x < width; ++x) {
+            freeRun_[cellIndex(x, y)] = static_cast<uint16_t>(width - x);
+        }
+    }
+    std::fill(rowMaxRun_.begin(), rowMaxRun_.end(), static_cast<uint16_t>(width));
+}
+
+} // namespace inventory
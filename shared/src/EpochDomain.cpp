@@ -0,0 +1,108 @@
+#include "EpochDomain.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace inventory {
+
+thread_local EpochDomain::ThreadState EpochDomain::threadState_;
+
+EpochDomain& EpochDomain::global() {
+    static EpochDomain domain;
+    return domain;
+}
+
+EpochDomain::~EpochDomain() {
+    // process exit, no reader is left
+    for (auto& retired : retired_) {
+        retired.reclaim();
+    }
+}
+
+EpochDomain::ThreadState::~ThreadState() {
+    if (slot) {
+        slot->pinned.store(0);
+        slot->claimed.store(false);
+    }
+}
+
+EpochDomain::ReaderSlot* EpochDomain::claimSlot() {
+    for (size_t i = 0; i < MAX_READER_THREADS; ++i) {
+        bool expected = false;
+        if (!slots_[i].claimed.load(std::memory_order_relaxed) && slots_[i].claimed.compare_exchange_strong(expected, true)) {
+            size_t used = slotsUsed_.load();
+            while (used < i + 1 && !slotsUsed_.compare_exchange_weak(used, i + 1)) {
+            }
+            return &slots_[i];
+        }
+    }
+    return nullptr;
+}
+
+void EpochDomain::pin() {
+    ThreadState& state = threadState_;
+    if (state.depth++ > 0) {
+        return;
+    }
+
+    if (!state.slot) {
+        state.slot = claimSlot();
+    }
+
+    // seq_cst store, ordered before the reader's pointer load: a writer that doesn't see this pin
+    // yet swapped its pointer before the reader loads it, so the reader gets the new object
+    if (state.slot) {
+        state.slot->pinned.store(epoch_.load());
+    } else {
+        unslottedReaders_.fetch_add(1);
+    }
+}
+
+void EpochDomain::unpin() {
+    ThreadState& state = threadState_;
+    if (--state.depth > 0) {
+        return;
+    }
+
+    if (state.slot) {
+        state.slot->pinned.store(0);
+    } else {
+        unslottedReaders_.fetch_sub(1);
+    }
+}
+
+void EpochDomain::retire(std::function<void()> reclaim) {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(retiredMutex_);
+
+        // readers pinning from here on see the next epoch and, pinning before they load, the new pointer
+        retired_.push_back(Retired{epoch_.fetch_add(1), std::move(reclaim)});
+
+        uint64_t oldestPinned = std::numeric_limits<uint64_t>::max();
+        if (unslottedReaders_.load() > 0) {
+            oldestPinned = 0;
+        }
+        size_t used = slotsUsed_.load();
+        for (size_t i = 0; i < used && oldestPinned > 0; ++i) {
+            uint64_t pinned = slots_[i].pinned.load();
+            if (pinned != 0 && pinned < oldestPinned) {
+                oldestPinned = pinned;
+            }
+        }
+
+        // retired before the oldest pinned epoch: nobody can still hold it
+        auto firstReady = std::partition(retired_.begin(), retired_.end(), [oldestPinned](const Retired& retired) {
+            return retired.epoch >= oldestPinned;
+        });
+        for (auto it = firstReady; it != retired_.end(); ++it) {
+            ready.push_back(std::move(it->reclaim));
+        }
+        retired_.erase(firstReady, retired_.end());
+    }
+
+    for (auto& reclaimNow : ready) {
+        reclaimNow();
+    }
+}
+
+} // namespace inventory
@@ -1,129 +1,259 @@
 #include "Inventory.hpp"
+#include "FixedInventory.hpp"
+#include "DynamicInventory.hpp"
+#include <algorithm>
+#include <atomic>
 
 namespace inventory {
 
+std::unique_ptr<Inventory> Inventory::create(int width, int height) {
+    // the game's two shapes get their compile-time sized grid
+    if (width == PersonalInventoryGrid::WIDTH && height == PersonalInventoryGrid::HEIGHT) {
+        return std::make_unique<PersonalInventoryGrid>();
+    }
+    if (width == StashInventoryGrid::WIDTH && height == StashInventoryGrid::HEIGHT) {
+        return std::make_unique<StashInventoryGrid>();
+    }
+    return std::make_unique<DynamicInventory>(width, height);
+}
+
 Inventory::Inventory(int width, int height) 
-    : width_(width), height_(height) {
-    grid_.resize(height);
-    for (int y = 0; y < height; ++y) {
-        grid_[y].resize(width);
-        for (int x = 0; x < width; ++x) {
-            grid_[y][x].position = GridPosition(x, y);
-        }
+    : width_(width), height_(height),
+      observer_(nullptr),
+      snapshot_(nullptr),
+      publishedVersion_(0),
+      version_(0), deltaBaseVersion_(0),
+      changed_(static_cast<size_t>(width) * height, false) {
+    InventorySnapshot* empty = new InventorySnapshot();
+    empty->width = width_;
+    empty->height = height_;
+    snapshot_.store(empty);
+    
+    // the domain has to outlive every inventory that retires into it
+    EpochDomain::global();
+}
+
+Inventory::~Inventory() {
+    EpochDomain::global().retire(snapshot_.load());
+}
+
+bool Inventory::publishSnapshot() {
+    if (version_ == publishedVersion_) {
+        return false;
+    }
+    
+    InventorySnapshot* snapshot = new InventorySnapshot();
+    snapshot->width = width_;
+    snapshot->height = height_;
+    snapshot->version = version_;
+    snapshot->items = records_;
+    
+    publishedVersion_ = version_;
+    EpochDomain::global().retire(snapshot_.exchange(snapshot));
+    return true;
+}
+
+void Inventory::markChanged(GridPosition pos) {
+    size_t index = static_cast<size_t>(pos.y) * width_ + pos.x;
+    if (!changed_[index]) {
+        changed_[index] = true;
+        changedOrigins_.push_back(pos);
+    }
+}
+
+InventoryDelta Inventory::takeDelta() {
+    InventoryDelta delta;
+    delta.baseVersion = deltaBaseVersion_;
+    delta.version = version_;
+    delta.changedOrigins.swap(changedOrigins_);
+    
+    for (const auto& pos : delta.changedOrigins) {
+        changed_[static_cast<size_t>(pos.y) * width_ + pos.x] = false;
+    }
+    deltaBaseVersion_ = version_;
+    
+    return delta;
+}
+
+void Inventory::rollbackTo(const Checkpoint& checkpoint) {
+    // a takeDelta() in between handed the changes out already, they can't be taken back
+    if (checkpoint.deltaBaseVersion != deltaBaseVersion_ || checkpoint.changeCount > changedOrigins_.size()) {
+        return;
+    }
+    
+    for (size_t i = checkpoint.changeCount; i < changedOrigins_.size(); ++i) {
+        const GridPosition& pos = changedOrigins_[i];
+        changed_[cellIndex(pos.x, pos.y)] = false;
     }
+    changedOrigins_.resize(checkpoint.changeCount);
+    version_ = checkpoint.version;
 }
 
 bool Inventory::isPositionValid(GridPosition pos) const {
     return pos.x >= 0 && pos.x < width_ && pos.y >= 0 && pos.y < height_;
 }
 
-bool Inventory::isAreaOccupied(GridPosition pos, ItemSize size) const {
-    for (int y = pos.y; y < pos.y + size.height; ++y) {
-        for (int x = pos.x; x < pos.x + size.width; ++x) {
-            if (!isPositionValid(GridPosition(x, y))) {
-                return true; // out of bounds counts as occupied
-            }
-            if (!grid_[y][x].isEmpty() || grid_[y][x].isOccupied) {
-                return true;
+std::vector<GridPosition> Inventory::findAllFits(ItemSize size) const {
+    std::vector<GridPosition> fits;
+    FitMap map = getFitMap(size);
+    for (int y = 0; y < map.height; ++y) {
+        for (int i = 0; i < map.rowWords; ++i) {
+            uint64_t bits = map.bits[static_cast<size_t>(y) * map.rowWords + i];
+            for (int x = i * 64; bits; ++x, bits >>= 1) {
+                if (bits & 1) {
+                    fits.push_back(GridPosition(x, y));
+                }
             }
         }
     }
-    return false;
+    return fits;
 }
 
-bool Inventory::canPlaceItem(const Item& item, GridPosition pos) const {
-    return !isAreaOccupied(pos, item.getSize());
+uint64_t Inventory::newInstanceId() {
+    static std::atomic<uint64_t> nextId{1};
+    return nextId.fetch_add(1, std::memory_order_relaxed);
 }
 
-bool Inventory::placeItem(std::shared_ptr<Item> item, uint32_t count, GridPosition pos) {
+bool Inventory::placeItem(ItemHandle item, uint32_t count, GridPosition pos, uint64_t instanceId) {
     if (!item || count == 0 || count > item->getStackLimit()) {
         return false;
     }
     
-    if (!canPlaceItem(*item, pos)) {
+    if (!isAreaFree(pos, item->getSize())) {
         return false;
     }
     
-    occupyArea(pos, item->getSize(), item, count);
+    InventorySlot record;
+    record.item = item;
+    record.stackCount = count;
+    record.position = pos;
+    record.instanceId = instanceId != 0 ? instanceId : newInstanceId();
+    
+    uint16_t index = static_cast<uint16_t>(records_.size());
+    records_.push_back(std::move(record));
+    setArea(pos, item->getSize(), index);
+    
+    if (observer_) {
+        observer_->onPlaced(*this, records_[index]);
+    }
+    
+    markChanged(pos);
+    ++version_;
     return true;
 }
 
-void Inventory::occupyArea(GridPosition pos, ItemSize size, std::shared_ptr<Item> item, uint32_t count) {
-    for (int y = pos.y; y < pos.y + size.height; ++y) {
-        for (int x = pos.x; x < pos.x + size.width; ++x) {
-            if (x == pos.x && y == pos.y) {
-                // top-left cell stores the item
-                grid_[y][x].item = item;
-                grid_[y][x].stackCount = count;
-                grid_[y][x].isOccupied = false;
-            } else {
-                // other cells are marked as occupied
-                grid_[y][x].item = nullptr;
-                grid_[y][x].stackCount = 0;
-                grid_[y][x].isOccupied = true;
-            }
-        }
+std::optional<InventorySlot> Inventory::removeItem(GridPosition pos) {
+    const InventorySlot* slot = getSlot(pos);
+    if (!slot) {
+        return std::nullopt;
     }
+    
+    uint16_t index = getCellOwner(pos);
+    InventorySlot result = std::move(records_[index]);
+    setArea(pos, result.item->getSize(), NO_RECORD);
+    
+    // keep records_ dense: the last record takes over the freed index
+    uint16_t last = static_cast<uint16_t>(records_.size() - 1);
+    if (index != last) {
+        records_[index] = std::move(records_[last]);
+        setArea(records_[index].position, records_[index].item->getSize(), index);
+    }
+    records_.pop_back();
+    
+    if (observer_) {
+        observer_->onRemoved(*this, result);
+    }
+    
+    markChanged(pos);
+    ++version_;
+    
+    return result;
 }
 
-void Inventory::clearArea(GridPosition pos, ItemSize size) {
-    for (int y = pos.y; y < pos.y + size.height; ++y) {
-        for (int x = pos.x; x < pos.x + size.width; ++x) {
-            if (isPositionValid(GridPosition(x, y))) {
-                grid_[y][x].item = nullptr;
-                grid_[y][x].stackCount = 0;
-                grid_[y][x].isOccupied = false;
-            }
-        }
+bool Inventory::setStackCount(GridPosition pos, uint32_t count) {
+    const InventorySlot* slot = getSlot(pos);
+    if (!slot || count == 0 || count > slot->item->getStackLimit()) {
+        return false;
     }
+    
+    records_[getCellOwner(pos)].stackCount = count;
+    markChanged(pos);
+    ++version_;
+    return true;
 }
 
-std::optional<InventorySlot> Inventory::removeItem(GridPosition pos) {
-    if (!isPositionValid(pos)) {
-        return std::nullopt;
+bool Inventory::adjustStack(GridPosition pos, int32_t delta) {
+    const InventorySlot* slot = getSlot(pos);
+    if (!slot) {
+        return false;
     }
     
-    InventorySlot& slot = grid_[pos.y][pos.x];
-    if (slot.isEmpty()) {
-        return std::nullopt;
+    int64_t count = static_cast<int64_t>(slot->stackCount) + delta;
+    if (count <= 0 || count > slot->item->getStackLimit()) {
+        return false;
+    }
+    return setStackCount(pos, static_cast<uint32_t>(count));
+}
+
+uint32_t Inventory::mergeInto(GridPosition src, Inventory& dest, GridPosition dst) {
+    if (&dest == this && src == dst) {
+        return 0;
     }
     
-    InventorySlot result = slot;
-    clearArea(pos, slot.item->getSize());
+    const InventorySlot* source = getSlot(src);
+    const InventorySlot* target = dest.getSlot(dst);
+    if (!source || !target || source->item->getId() != target->item->getId()) {
+        return 0;
+    }
     
-    return result;
+    uint32_t limit = target->item->getStackLimit();
+    if (target->stackCount >= limit) {
+        return 0;
+    }
+    
+    uint32_t amount = std::min(source->stackCount, limit - target->stackCount);
+    uint32_t remaining = source->stackCount - amount;
+    
+    dest.setStackCount(dst, target->stackCount + amount);
+    if (remaining > 0) {
+        setStackCount(src, remaining);
+    } else {
+        removeItem(src);
+    }
+    return amount;
 }
 
 const InventorySlot* Inventory::getSlot(GridPosition pos) const {
     if (!isPositionValid(pos)) {
         return nullptr;
     }
-    return &grid_[pos.y][pos.x];
+    
+    uint16_t index = getCellOwner(pos);
+    if (index == NO_RECORD || !(records_[index].position == pos)) {
+        return nullptr;
+    }
+    return &records_[index];
 }
 
 std::vector<InventorySlot> Inventory::getAllItems() const {
-    std::vector<InventorySlot> items;
-    
-    for (int y = 0; y < height_; ++y) {
-        for (int x = 0; x < width_; ++x) {
-            const auto& slot = grid_[y][x];
-            if (!slot.isEmpty()) {
-                items.push_back(slot);
-            }
-        }
-    }
-    
+    // row-major by origin, same order as a scan of the grid would give
+    std::vector<InventorySlot> items(records_.begin(), records_.end());
+    std::sort(items.begin(), items.end(), [](const InventorySlot& a, const InventorySlot& b) {
+        return a.position.y != b.position.y ? a.position.y < b.position.y : a.position.x < b.position.x;
+    });
     return items;
 }
 
 void Inventory::clear() {
-    for (int y = 0; y < height_; ++y) {
-        for (int x = 0; x < width_; ++x) {
-            grid_[y][x].item = nullptr;
-            grid_[y][x].stackCount = 0;
-            grid_[y][x].isOccupied = false;
+    for (const auto& record : records_) {
+        markChanged(record.position);
+        if (observer_) {
+            observer_->onRemoved(*this, record);
         }
     }
+    records_.clear();
+    clearGrid();
+    ++version_;
 }
 
 } // namespace inventory
@@ -0,0 +1,47 @@
+#include "ItemTable.hpp"
+
+namespace inventory {
+
+std::unique_ptr<Item[]> ItemTable::chunks_[ItemTable::MAX_CHUNKS];
+std::unordered_map<uint32_t, uint32_t> ItemTable::indexById_;
+uint32_t ItemTable::count_ = 0;
+std::mutex ItemTable::mutex_;
+
+ItemHandle ItemTable::intern(const Item& item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    
+    auto it = indexById_.find(item.getId());
+    if (it != indexById_.end()) {
+        return ItemHandle(it->second);
+    }
+    
+    if (count_ >= MAX_CHUNKS * CHUNK_SIZE) {
+        return ItemHandle();
+    }
+    
+    uint32_t index = count_;
+    std::unique_ptr<Item[]>& chunk = chunks_[index >> CHUNK_BITS];
+    if (!chunk) {
+        chunk.reset(new Item[CHUNK_SIZE]);
+    }
+    chunk[index & (CHUNK_SIZE - 1)] = item;
+    
+    // the handle only leaves this function after the entry is written, and reaches other
+    // threads through whatever synchronizes the inventory it ends up in
+    indexById_[item.getId()] = index;
+    ++count_;
+    return ItemHandle(index);
+}
+
+ItemHandle ItemTable::find(uint32_t itemId) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = indexById_.find(itemId);
+    return it != indexById_.end() ? ItemHandle(it->second) : ItemHandle();
+}
+
+size_t ItemTable::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+} // namespace inventory
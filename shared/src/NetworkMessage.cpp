@@ -20,6 +20,10 @@ std::vector<uint8_t> NetworkMessage::serialize() const {
     return result;
 }
 
+EncodedFrame NetworkMessage::encode() const {
+    return std::make_shared<const std::vector<uint8_t>>(serialize());
+}
+
 NetworkMessage NetworkMessage::deserialize(const std::vector<uint8_t>& data) {
     NetworkMessage msg;
     
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <iostream>
+
+// minimal assertions for the test executables: a failed CHECK is reported and counted,
+// the test keeps going and main returns TEST_RESULT()
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+} // namespace test
+
+#define CHECK(condition)                                                                          \
+    do {                                                                                          \
+        if (!(condition)) {                                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+            ++test::failures();                                                                   \
+        }                                                                                         \
+    } while (0)
+
+#define TEST_RESULT() (test::failures() == 0 ? 0 : 1)
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "Server.hpp"
+#include "FrameBuffer.hpp"
+#include "NetworkMessage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// a real server on a free loopback port and a blocking client speaking its protocol,
+// for the tests and benchmarks that go through the network
+namespace test {
+
+// a port nobody listens on right now (bound once without SO_REUSEPORT, so a port some other
+// server shares through SO_REUSEPORT is never picked)
+inline int findFreePort() {
+    int probe = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    int port = -1;
+    socklen_t length = sizeof(addr);
+    if (bind(probe, (sockaddr *)&addr, sizeof(addr)) == 0 && getsockname(probe, (sockaddr *)&addr, &length) == 0) {
+        port = ntohs(addr.sin_port);
+    }
+    close(probe);
+    return port;
+}
+
+// nullptr if no port could be bound
+inline std::unique_ptr<inventory::Server> startServer(const inventory::ServerConfig &config, int &port) {
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        port = findFreePort();
+        auto server = std::make_unique<inventory::Server>(port, config);
+        server->start();
+        if (server->isRunning()) {
+            return server;
+        }
+    }
+    return nullptr;
+}
+
+class TestClient {
+public:
+    explicit TestClient(int port) : socket_(socket(AF_INET, SOCK_STREAM, 0)) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (connect(socket_, (sockaddr *)&addr, sizeof(addr)) < 0) {
+            close();
+            return;
+        }
+
+        int noDelay = 1;
+        setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    ~TestClient() { close(); }
+
+    TestClient(const TestClient &) = delete;
+    TestClient &operator=(const TestClient &) = delete;
+
+    bool isConnected() const { return socket_ >= 0; }
+
+    void close() {
+        if (socket_ >= 0) {
+            ::close(socket_);
+            socket_ = -1;
+        }
+    }
+
+    bool send(inventory::MessageType type, const std::vector<uint8_t> &payload = {}) {
+        inventory::NetworkMessage msg(type);
+        msg.payload = payload;
+        return sendBytes(msg.serialize());
+    }
+
+    // several frames written at once, the way a pipelining client sends them
+    bool sendBytes(const std::vector<uint8_t> &bytes) {
+        size_t sent = 0;
+        while (sent < bytes.size() && socket_ >= 0) {
+            ssize_t written = ::send(socket_, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(written);
+        }
+        return sent == bytes.size();
+    }
+
+    // nullopt on timeout or when the server closed the connection
+    std::optional<inventory::NetworkMessage> receive(int timeoutMs = 2000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        inventory::NetworkMessage msg;
+        while (buffer_.nextFrame(msg) != inventory::FrameBuffer::FrameResult::FRAME) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            pollfd fd{socket_, POLLIN, 0};
+            if (socket_ < 0 || left <= 0 || poll(&fd, 1, static_cast<int>(left)) <= 0) {
+                return std::nullopt;
+            }
+
+            size_t space = 0;
+            uint8_t *region = buffer_.writeRegion(space);
+            ssize_t bytesRead = recv(socket_, region, space, 0);
+            if (bytesRead <= 0) {
+                return std::nullopt;
+            }
+            buffer_.commit(static_cast<size_t>(bytesRead));
+        }
+        return msg;
+    }
+
+    // skips everything else
+    std::optional<inventory::NetworkMessage> receiveType(inventory::MessageType type, int timeoutMs = 2000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (true) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            std::optional<inventory::NetworkMessage> msg = receive(static_cast<int>(std::max<long long>(left, 0)));
+            if (!msg || msg->type == type) {
+                return msg;
+            }
+        }
+    }
+
+    // logged in once the personal inventory's full sync arrived
+    bool login(const std::string &username) {
+        send(inventory::MessageType::LOGIN_REQUEST, std::vector<uint8_t>(username.begin(), username.end()));
+        std::optional<inventory::NetworkMessage> response = receive();
+        return response && response->type == inventory::MessageType::LOGIN_RESPONSE &&
+               receiveType(inventory::MessageType::INVENTORY_FULL_SYNC).has_value();
+    }
+
+private:
+    int socket_;
+    inventory::FrameBuffer buffer_;
+};
+
+} // namespace test
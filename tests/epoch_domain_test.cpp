@@ -0,0 +1,159 @@
+#include "Check.hpp"
+#include "EpochDomain.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// a thread that pins the epoch (pinned once the constructor returns) and holds it until told to let go
+class Reader {
+public:
+    Reader() : thread_([this]() { run(); }) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [this]() { return pinned_; });
+    }
+
+    ~Reader() {
+        release();
+        thread_.join();
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        released_ = true;
+        changed_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool pinned_ = false;
+    bool released_ = false;
+    std::thread thread_;
+
+    void run() {
+        EpochDomain::Guard guard;
+        std::unique_lock<std::mutex> lock(mutex_);
+        pinned_ = true;
+        changed_.notify_all();
+        changed_.wait(lock, [this]() { return released_; });
+    }
+};
+
+void testReclaimsRightAwayWithoutReaders() {
+    bool reclaimed = false;
+    EpochDomain::global().retire([&reclaimed]() { reclaimed = true; });
+    CHECK(reclaimed);
+}
+
+// whatever is retired while a reader is pinned waits until that reader lets go
+void testPinnedReaderHoldsBackReclaim() {
+    bool during = false;
+    bool after = false;
+    auto reader = std::make_unique<Reader>();
+
+    EpochDomain::global().retire([&during]() { during = true; });
+    CHECK(!during);
+    EpochDomain::global().retire([]() {});
+    CHECK(!during);
+
+    reader->release();
+    reader.reset();
+
+    // the next retire collects it
+    EpochDomain::global().retire([&after]() { after = true; });
+    CHECK(during);
+    CHECK(after);
+}
+
+// an inner guard's end doesn't unpin the outer one
+void testGuardsNest() {
+    bool reclaimed = false;
+    {
+        EpochDomain::Guard outer;
+        {
+            EpochDomain::Guard inner;
+        }
+        EpochDomain::global().retire([&reclaimed]() { reclaimed = true; });
+        CHECK(!reclaimed);
+    }
+    EpochDomain::global().retire([]() {});
+    CHECK(reclaimed);
+}
+
+// readers load and use an object a writer keeps swapping out, the way snapshot readers do:
+// none of them ever sees one that was reclaimed
+void testSwappedObjectsStayAliveForReaders() {
+    struct Box {
+        std::atomic<bool> alive{true};
+        uint64_t value = 0;
+    };
+
+    std::atomic<Box*> current{new Box()};
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> deadReads{0};
+    std::atomic<uint64_t> reclaimedCount{0};
+
+    // reclaimed boxes are only marked dead and kept until the end, so a reader that got one
+    // too early reads the mark instead of freed memory
+    std::mutex graveyardMutex;
+    std::vector<Box*> graveyard;
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&]() {
+            while (!stop) {
+                EpochDomain::Guard guard;
+                Box* box = current.load();
+                for (int i = 0; i < 16; ++i) {
+                    if (!box->alive.load()) {
+                        ++deadReads;
+                    }
+                }
+            }
+        });
+    }
+
+    for (uint64_t i = 1; i <= 20000; ++i) {
+        Box* next = new Box();
+        next->value = i;
+        Box* old = current.exchange(next);
+        EpochDomain::global().retire([old, &graveyardMutex, &graveyard, &reclaimedCount]() {
+            old->alive = false;
+            ++reclaimedCount;
+            std::lock_guard<std::mutex> lock(graveyardMutex);
+            graveyard.push_back(old);
+        });
+    }
+
+    stop = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    CHECK(deadReads == 0);
+    CHECK(reclaimedCount > 0);
+
+    EpochDomain::global().retire([]() {});
+    CHECK(reclaimedCount == 20000);  // no reader left, everything retired is collected
+
+    delete current.load();
+    for (Box* box : graveyard) {
+        delete box;
+    }
+}
+
+} // namespace
+
+int main() {
+    testReclaimsRightAwayWithoutReaders();
+    testPinnedReaderHoldsBackReclaim();
+    testGuardsNest();
+    testSwappedObjectsStayAliveForReaders();
+    return TEST_RESULT();
+}
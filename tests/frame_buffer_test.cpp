@@ -0,0 +1,115 @@
+#include "Check.hpp"
+#include "FrameBuffer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// copies bytes in through writeRegion/commit, the way the reactor's recv does, at most chunk at a time
+void feed(FrameBuffer& buffer, const std::vector<uint8_t>& bytes, size_t chunk) {
+    size_t offset = 0;
+    while (offset < bytes.size()) {
+        size_t space = 0;
+        uint8_t* region = buffer.writeRegion(space);
+        size_t length = std::min({space, chunk, bytes.size() - offset});
+        std::memcpy(region, bytes.data() + offset, length);
+        buffer.commit(length);
+        offset += length;
+    }
+}
+
+std::vector<uint8_t> frame(MessageType type, size_t payloadSize, uint8_t fill) {
+    NetworkMessage msg(type);
+    msg.payload.assign(payloadSize, fill);
+    return msg.serialize();
+}
+
+void testPipelinedFrames() {
+    FrameBuffer buffer(64);
+    std::vector<uint8_t> bytes;
+    for (int i = 0; i < 5; ++i) {
+        std::vector<uint8_t> one = frame(MessageType::MOVE_ITEM_REQUEST, 6, static_cast<uint8_t>(i));
+        bytes.insert(bytes.end(), one.begin(), one.end());
+    }
+    feed(buffer, bytes, bytes.size());
+
+    NetworkMessage msg;
+    for (int i = 0; i < 5; ++i) {
+        CHECK(buffer.nextFrame(msg) == FrameBuffer::FrameResult::FRAME);
+        CHECK(msg.type == MessageType::MOVE_ITEM_REQUEST);
+        CHECK(msg.payload == std::vector<uint8_t>(6, static_cast<uint8_t>(i)));
+    }
+    CHECK(buffer.nextFrame(msg) == FrameBuffer::FrameResult::INCOMPLETE);
+    CHECK(buffer.size() == 0);
+}
+
+void testSplitFrame() {
+    // a frame trickling in one byte per recv is only popped once it's whole
+    FrameBuffer buffer(64);
+    std::vector<uint8_t> bytes = frame(MessageType::LOGIN_REQUEST, 10, 'a');
+    NetworkMessage msg;
+    for (size_t i = 0; i + 1 < bytes.size(); ++i) {
+        feed(buffer, {bytes[i]}, 1);
+        CHECK(buffer.nextFrame(msg) == FrameBuffer::FrameResult::INCOMPLETE);
+    }
+    feed(buffer, {bytes.back()}, 1);
+    CHECK(buffer.nextFrame(msg) == FrameBuffer::FrameResult::FRAME);
+    CHECK(msg.payload == std::vector<uint8_t>(10, 'a'));
+}
+
+void testWrapAround() {
+    // fed in chunks that don't line up with the frames, the buffer rarely runs empty (which would
+    // reset it to offset 0), so later frames wrap past the end of the storage
+    FrameBuffer buffer(32);
+    std::vector<uint8_t> stream;
+    for (int i = 0; i < 100; ++i) {
+        std::vector<uint8_t> one = frame(MessageType::SYNC_REQUEST, static_cast<size_t>(i % 13), static_cast<uint8_t>(i));
+        stream.insert(stream.end(), one.begin(), one.end());
+    }
+
+    NetworkMessage msg;
+    int popped = 0;
+    for (size_t offset = 0; offset < stream.size(); offset += 7) {
+        size_t end = std::min(offset + 7, stream.size());
+        feed(buffer, std::vector<uint8_t>(stream.begin() + offset, stream.begin() + end), 7);
+        while (buffer.nextFrame(msg) == FrameBuffer::FrameResult::FRAME) {
+            CHECK(msg.payload == std::vector<uint8_t>(static_cast<size_t>(popped % 13), static_cast<uint8_t>(popped)));
+            ++popped;
+        }
+    }
+    CHECK(popped == 100);
+    CHECK(buffer.capacity() == 32);
+}
+
+void testGrowth() {
+    FrameBuffer buffer(16);
+    std::vector<uint8_t> bytes = frame(MessageType::SORT_INVENTORY, 1000, 7);
+    feed(buffer, bytes, 100);
+    CHECK(buffer.capacity() >= bytes.size());
+
+    NetworkMessage msg;
+    CHECK(buffer.nextFrame(msg) == FrameBuffer::FrameResult::FRAME);
+    CHECK(msg.payload == std::vector<uint8_t>(1000, 7));
+}
+
+void testOversizedFrame() {
+    FrameBuffer buffer(64, 100);
+    feed(buffer, frame(MessageType::LOGIN_REQUEST, 101, 0), 64);
+
+    NetworkMessage msg;
+    CHECK(buffer.nextFrame(msg) == FrameBuffer::FrameResult::INVALID);
+}
+
+} // namespace
+
+int main() {
+    testPipelinedFrames();
+    testSplitFrame();
+    testWrapAround();
+    testGrowth();
+    testOversizedFrame();
+    return TEST_RESULT();
+}
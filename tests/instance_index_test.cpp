@@ -0,0 +1,100 @@
+#include "Check.hpp"
+#include "FixedInventory.hpp"
+#include "InstanceIndex.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+ItemHandle potion() {
+    static ItemHandle item = ItemTable::intern(Item(9600, "Index potion", ItemSize(1, 1), 20, ""));
+    return item;
+}
+
+void testFollowsMovedStacks() {
+    InstanceIndex index;
+    PersonalInventoryGrid personal;
+    StashInventoryGrid stash;
+    personal.placeItem(potion(), 3, GridPosition(1, 1));
+    uint64_t id = personal.getSlot(GridPosition(1, 1))->instanceId;
+
+    index.attach(&personal);  // picks up what is already there
+    index.attach(&stash);
+    std::optional<InstanceIndex::Location> location = index.find(id);
+    CHECK(location && location->inventory == &personal && location->origin == GridPosition(1, 1));
+
+    // a move places the stack under its old id before the old cell is cleared: the entry follows it
+    stash.placeItem(potion(), 3, GridPosition(7, 9), id);
+    personal.removeItem(GridPosition(1, 1));
+    location = index.find(id);
+    CHECK(location && location->inventory == &stash && location->origin == GridPosition(7, 9));
+
+    stash.removeItem(GridPosition(7, 9));
+    CHECK(!index.find(id).has_value());
+
+    personal.placeItem(potion(), 1, GridPosition(0, 0));
+    CHECK(index.size() == 1);
+    index.detach(&personal);
+    index.detach(&stash);
+    CHECK(index.size() == 0);
+}
+
+// inventories on different threads reporting to one index at once, the way workers and stash actors do
+void testConcurrentWriters() {
+    InstanceIndex index;
+    const int threadCount = 8;
+    std::vector<std::unique_ptr<StashInventoryGrid>> inventories;
+    for (int i = 0; i < threadCount; ++i) {
+        inventories.push_back(std::make_unique<StashInventoryGrid>());
+        index.attach(inventories.back().get());
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&index, &inventories, t]() {
+            Inventory& inventory = *inventories[t];
+            for (int round = 0; round < 2000; ++round) {
+                GridPosition pos(round % 12, (round / 12) % 12);
+                if (inventory.getSlot(pos)) {
+                    uint64_t id = inventory.getSlot(pos)->instanceId;
+                    inventory.removeItem(pos);
+                    CHECK(!index.find(id).has_value());
+                } else {
+                    CHECK(inventory.placeItem(potion(), 1, pos));
+                    std::optional<InstanceIndex::Location> location = index.find(inventory.getSlot(pos)->instanceId);
+                    CHECK(location && location->inventory == &inventory && location->origin == pos);
+                }
+                inventory.takeDelta();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    size_t expected = 0;
+    for (const auto& inventory : inventories) {
+        expected += inventory->getItemCount();
+        inventory->forEachItem([&index, &inventory](const InventorySlot& slot) {
+            std::optional<InstanceIndex::Location> location = index.find(slot.instanceId);
+            CHECK(location && location->inventory == inventory.get() && location->origin == slot.position);
+        });
+    }
+    CHECK(index.size() == expected);
+
+    for (const auto& inventory : inventories) {
+        index.detach(inventory.get());
+    }
+    CHECK(index.size() == 0);
+}
+
+} // namespace
+
+int main() {
+    testFollowsMovedStacks();
+    testConcurrentWriters();
+    return TEST_RESULT();
+}
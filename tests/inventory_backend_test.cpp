@@ -0,0 +1,110 @@
+#include "Check.hpp"
+#include "FixedInventory.hpp"
+#include "DynamicInventory.hpp"
+#include <random>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+bool sameItems(const Inventory& a, const Inventory& b) {
+    std::vector<InventorySlot> left = a.getAllItems();
+    std::vector<InventorySlot> right = b.getAllItems();
+    if (left.size() != right.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < left.size(); ++i) {
+        if (!(left[i].position == right[i].position) || left[i].item->getId() != right[i].item->getId() ||
+            left[i].stackCount != right[i].stackCount || left[i].instanceId != right[i].instanceId) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the same random operations on a fixed and a dynamic grid of one shape: every result, the
+// contents, versions and deltas have to match
+template <int W, int H>
+void runInLockstep(std::mt19937& rng, const std::vector<ItemHandle>& items) {
+    FixedInventory<W, H> fixed;
+    DynamicInventory dynamic(W, H);
+
+    std::uniform_int_distribution<int> pickX(0, W - 1);
+    std::uniform_int_distribution<int> pickY(0, H - 1);
+    std::uniform_int_distribution<size_t> pickItem(0, items.size() - 1);
+    std::uniform_int_distribution<int> pickOp(0, 99);
+    uint64_t nextInstance = 1;
+
+    for (int step = 0; step < 20000; ++step) {
+        GridPosition pos(pickX(rng), pickY(rng));
+        GridPosition other(pickX(rng), pickY(rng));
+        int op = pickOp(rng);
+
+        if (op < 45) {
+            const ItemHandle& item = items[pickItem(rng)];
+            uint64_t instance = nextInstance++;
+            CHECK(fixed.placeItem(item, 1, pos, instance) == dynamic.placeItem(item, 1, pos, instance));
+        } else if (op < 75) {
+            std::optional<InventorySlot> a = fixed.removeItem(pos);
+            std::optional<InventorySlot> b = dynamic.removeItem(pos);
+            CHECK(a.has_value() == b.has_value());
+            CHECK(!a || !b || a->instanceId == b->instanceId);
+        } else if (op < 85) {
+            int32_t delta = static_cast<int32_t>(pickOp(rng) % 7) - 3;
+            CHECK(fixed.adjustStack(pos, delta) == dynamic.adjustStack(pos, delta));
+        } else if (op < 95) {
+            CHECK(fixed.mergeInto(pos, fixed, other) == dynamic.mergeInto(pos, dynamic, other));
+        } else if (op < 99) {
+            ItemSize size = items[pickItem(rng)]->getSize();
+            std::optional<GridPosition> a = fixed.findFirstFit(size);
+            std::optional<GridPosition> b = dynamic.findFirstFit(size);
+            CHECK(a.has_value() == b.has_value() && (!a || *a == *b));
+            CHECK(fixed.findAllFits(size) == dynamic.findAllFits(size));
+        } else {
+            fixed.clear();
+            dynamic.clear();
+        }
+
+        CHECK(fixed.getVersion() == dynamic.getVersion());
+        CHECK(fixed.getItemCount() == dynamic.getItemCount());
+
+        if (step % 50 == 0) {
+            CHECK(sameItems(fixed, dynamic));
+
+            InventoryDelta a = fixed.takeDelta();
+            InventoryDelta b = dynamic.takeDelta();
+            CHECK(a.baseVersion == b.baseVersion && a.version == b.version);
+            CHECK(a.changedOrigins == b.changedOrigins);
+        }
+    }
+    CHECK(sameItems(fixed, dynamic));
+}
+
+void testCreatePicksTheGrid() {
+    CHECK(dynamic_cast<PersonalInventoryGrid*>(Inventory::create(12, 5).get()) != nullptr);
+    CHECK(dynamic_cast<StashInventoryGrid*>(Inventory::create(12, 12).get()) != nullptr);
+    CHECK(dynamic_cast<DynamicInventory*>(Inventory::create(5, 12).get()) != nullptr);
+
+    std::unique_ptr<Inventory> odd = Inventory::create(20, 7);
+    CHECK(odd->getWidth() == 20 && odd->getHeight() == 7);
+}
+
+} // namespace
+
+int main() {
+    std::vector<ItemHandle> items;
+    const ItemSize sizes[] = {{1, 1}, {1, 2}, {2, 2}, {2, 3}, {2, 4}, {1, 1}};
+    uint32_t id = 9100;
+    for (ItemSize size : sizes) {
+        // stackable small items so merges and count changes happen too
+        items.push_back(ItemTable::intern(Item(id++, "Backend test item", size, size.width * size.height == 1 ? 20 : 1, "")));
+    }
+
+    std::mt19937 rng(19);
+    runInLockstep<12, 5>(rng, items);
+    runInLockstep<12, 12>(rng, items);
+    testCreatePicksTheGrid();
+
+    return TEST_RESULT();
+}
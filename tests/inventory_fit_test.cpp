@@ -0,0 +1,92 @@
+#include "Check.hpp"
+#include "Inventory.hpp"
+#include "DynamicInventory.hpp"
+#include <random>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// the sizes the game's items come in
+const ItemSize SIZES[] = {{1, 1}, {1, 2}, {2, 1}, {2, 2}, {2, 3}, {2, 4}, {3, 1}, {4, 4}};
+
+std::vector<ItemHandle> makeItems() {
+    std::vector<ItemHandle> items;
+    uint32_t id = 9000;
+    for (ItemSize size : SIZES) {
+        items.push_back(ItemTable::intern(Item(id++, "Fit test item", size, 1, "")));
+    }
+    return items;
+}
+
+// every fit query against the plain per-position test, on a randomly filled grid
+void checkAgainstBruteForce(Inventory& inventory, std::mt19937& rng, const std::vector<ItemHandle>& items) {
+    std::uniform_int_distribution<int> pickX(0, inventory.getWidth() - 1);
+    std::uniform_int_distribution<int> pickY(0, inventory.getHeight() - 1);
+    std::uniform_int_distribution<size_t> pickItem(0, items.size() - 1);
+
+    for (int round = 0; round < 200; ++round) {
+        // fill up, then punch holes, so the grid is fragmented most of the time
+        GridPosition pos(pickX(rng), pickY(rng));
+        if (round % 3 == 2) {
+            inventory.removeItem(pos);
+        } else {
+            inventory.placeItem(items[pickItem(rng)], 1, pos);
+        }
+
+        for (const ItemHandle& item : items) {
+            ItemSize size = item->getSize();
+            std::vector<GridPosition> expected;
+            for (int y = 0; y < inventory.getHeight(); ++y) {
+                for (int x = 0; x < inventory.getWidth(); ++x) {
+                    if (inventory.canPlaceItem(*item, GridPosition(x, y))) {
+                        expected.push_back(GridPosition(x, y));
+                    }
+                }
+            }
+
+            CHECK(inventory.findAllFits(size) == expected);
+
+            std::optional<GridPosition> first = inventory.findFirstFit(size);
+            CHECK(expected.empty() ? !first.has_value() : first && *first == expected.front());
+
+            FitMap map = inventory.getFitMap(size);
+            size_t fitting = 0;
+            for (int y = 0; y < inventory.getHeight(); ++y) {
+                for (int x = 0; x < inventory.getWidth(); ++x) {
+                    fitting += map.fits(GridPosition(x, y)) ? 1 : 0;
+                }
+            }
+            CHECK(fitting == expected.size());
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    std::vector<ItemHandle> items = makeItems();
+    std::mt19937 rng(11);
+
+    // the game's two shapes (fixed grids from create(), and the dynamic grid in the same shapes),
+    // rows spanning several bitboard words, and a row ending on a word boundary
+    const int shapes[][2] = {{12, 5}, {12, 12}, {70, 3}, {130, 4}, {64, 6}, {3, 9}};
+    for (const auto& shape : shapes) {
+        std::unique_ptr<Inventory> inventory = Inventory::create(shape[0], shape[1]);
+        checkAgainstBruteForce(*inventory, rng, items);
+
+        DynamicInventory dynamic(shape[0], shape[1]);
+        checkAgainstBruteForce(dynamic, rng, items);
+    }
+
+    // nothing fits that is larger than the grid, or has no size at all
+    for (const auto& small : {Inventory::create(3, 3), Inventory::create(12, 5)}) {
+        CHECK(small->findAllFits(ItemSize{13, 1}).empty());
+        CHECK(!small->findFirstFit(ItemSize{1, 13}).has_value());
+        CHECK(small->findAllFits(ItemSize{0, 1}).empty());
+        CHECK(!small->findFirstFit(ItemSize{1, 0}).has_value());
+    }
+
+    return TEST_RESULT();
+}
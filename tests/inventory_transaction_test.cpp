@@ -0,0 +1,147 @@
+#include "Check.hpp"
+#include "FixedInventory.hpp"
+#include "InventoryTransaction.hpp"
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// item id, count, position and instance id of every stack, in a fixed order
+using Contents = std::vector<std::tuple<uint32_t, uint32_t, int, int, uint64_t>>;
+
+Contents contentsOf(const Inventory& inventory) {
+    Contents contents;
+    inventory.forEachItem([&contents](const InventorySlot& slot) {
+        contents.emplace_back(slot.item->getId(), slot.stackCount, slot.position.x, slot.position.y, slot.instanceId);
+    });
+    std::sort(contents.begin(), contents.end());
+    return contents;
+}
+
+struct Fixture {
+    ItemHandle potion = ItemTable::intern(Item(9500, "Transaction potion", ItemSize(1, 1), 20, ""));
+    ItemHandle sword = ItemTable::intern(Item(9501, "Transaction sword", ItemSize(1, 3), 1, ""));
+    ItemHandle shield = ItemTable::intern(Item(9502, "Transaction shield", ItemSize(2, 2), 1, ""));
+
+    PersonalInventoryGrid personal;
+    StashInventoryGrid stash;
+
+    Fixture() {
+        personal.placeItem(potion, 5, GridPosition(0, 0));
+        personal.placeItem(sword, 1, GridPosition(3, 0));
+        stash.placeItem(potion, 18, GridPosition(0, 0));
+        stash.placeItem(shield, 1, GridPosition(4, 4));
+        personal.takeDelta();
+        stash.takeDelta();
+    }
+};
+
+void testCommitKeepsEveryStep() {
+    Fixture f;
+    uint32_t version = f.personal.getVersion();
+
+    InventoryTransaction transaction;
+    std::optional<InventorySlot> sword = transaction.remove(&f.personal, GridPosition(3, 0));
+    CHECK(sword.has_value());
+    CHECK(transaction.place(&f.stash, sword->item, 1, GridPosition(8, 8), sword->instanceId));
+    CHECK(transaction.adjustStack(&f.personal, GridPosition(0, 0), 2));
+    transaction.commit();
+    CHECK(!transaction.isOpen());
+
+    CHECK(f.personal.getSlot(GridPosition(3, 0)) == nullptr);
+    CHECK(f.stash.getSlot(GridPosition(8, 8)) && f.stash.getSlot(GridPosition(8, 8))->instanceId == sword->instanceId);
+    CHECK(f.personal.getSlot(GridPosition(0, 0))->stackCount == 7);
+    CHECK(f.personal.getVersion() > version);
+    CHECK(!f.personal.takeDelta().empty());
+    CHECK(!f.stash.takeDelta().empty());
+}
+
+// a step of every kind on both inventories, then abort: contents, versions and change logs
+// are exactly what they were
+void testAbortRestoresEverything() {
+    Fixture f;
+    Contents personalBefore = contentsOf(f.personal);
+    Contents stashBefore = contentsOf(f.stash);
+    uint32_t personalVersion = f.personal.getVersion();
+    uint32_t stashVersion = f.stash.getVersion();
+
+    InventoryTransaction transaction;
+    std::optional<InventorySlot> sword = transaction.remove(&f.personal, GridPosition(3, 0));
+    CHECK(sword.has_value());
+    CHECK(transaction.place(&f.stash, sword->item, 1, GridPosition(10, 0), sword->instanceId));
+    CHECK(transaction.place(&f.personal, f.shield, 1, GridPosition(5, 2)));
+    CHECK(transaction.setStackCount(&f.stash, GridPosition(0, 0), 3));
+    CHECK(transaction.adjustStack(&f.personal, GridPosition(0, 0), -1));
+    CHECK(transaction.mergeInto(&f.stash, GridPosition(0, 0), &f.personal, GridPosition(0, 0)) == 3);
+    CHECK(f.stash.getSlot(GridPosition(0, 0)) == nullptr);  // merged away completely
+    transaction.abort();
+
+    CHECK(contentsOf(f.personal) == personalBefore);
+    CHECK(contentsOf(f.stash) == stashBefore);
+    CHECK(f.personal.getVersion() == personalVersion);
+    CHECK(f.stash.getVersion() == stashVersion);
+    CHECK(f.personal.takeDelta().empty());
+    CHECK(f.stash.takeDelta().empty());
+
+    // the grids are consistent again: the cells the aborted steps used are free
+    CHECK(f.stash.canPlaceItem(*f.sword, GridPosition(10, 0)));
+    CHECK(f.personal.canPlaceItem(*f.shield, GridPosition(5, 2)));
+    CHECK(!f.personal.canPlaceItem(*f.sword, GridPosition(3, 0)));
+}
+
+// changes recorded before the transaction stay in the next delta, only the transaction's go
+void testAbortKeepsEarlierChanges() {
+    Fixture f;
+    f.personal.placeItem(f.potion, 1, GridPosition(6, 0));
+    uint32_t version = f.personal.getVersion();
+
+    {
+        InventoryTransaction transaction;
+        CHECK(transaction.place(&f.personal, f.potion, 4, GridPosition(7, 0)));
+        // destroyed without commit(): aborts
+    }
+
+    CHECK(f.personal.getVersion() == version);
+    CHECK(f.personal.getSlot(GridPosition(7, 0)) == nullptr);
+    InventoryDelta delta = f.personal.takeDelta();
+    CHECK(delta.changedOrigins.size() == 1 && delta.changedOrigins[0] == GridPosition(6, 0));
+    CHECK(delta.version == version);
+}
+
+// a step that doesn't apply changes nothing and isn't undone later
+void testFailedStepsChangeNothing() {
+    Fixture f;
+    Contents before = contentsOf(f.personal);
+    uint32_t version = f.personal.getVersion();
+
+    InventoryTransaction transaction;
+    CHECK(!transaction.place(&f.personal, f.shield, 1, GridPosition(3, 1)));   // on the sword
+    CHECK(!transaction.place(&f.personal, f.shield, 1, GridPosition(11, 0)));  // off the grid
+    CHECK(!transaction.remove(&f.personal, GridPosition(9, 4)).has_value());
+    CHECK(!transaction.adjustStack(&f.personal, GridPosition(0, 0), 100));     // over the stack limit
+    CHECK(!transaction.setStackCount(&f.personal, GridPosition(9, 4), 2));
+    CHECK(transaction.mergeInto(&f.personal, GridPosition(3, 0), &f.stash, GridPosition(0, 0)) == 0);
+    CHECK(contentsOf(f.personal) == before);
+    CHECK(f.personal.getVersion() == version);
+
+    transaction.abort();
+    CHECK(contentsOf(f.personal) == before);
+    CHECK(f.personal.getVersion() == version);
+
+    // a closed transaction takes no more steps
+    CHECK(!transaction.place(&f.personal, f.potion, 1, GridPosition(9, 4)));
+    CHECK(f.personal.getSlot(GridPosition(9, 4)) == nullptr);
+}
+
+} // namespace
+
+int main() {
+    testCommitKeepsEveryStep();
+    testAbortRestoresEverything();
+    testAbortKeepsEarlierChanges();
+    testFailedStepsChangeNothing();
+    return TEST_RESULT();
+}
@@ -0,0 +1,101 @@
+#include "Check.hpp"
+#include "MpscQueue.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+void testFifoOnOneThread() {
+    MpscQueue<int> queue;
+    int value = -1;
+    CHECK(!queue.pop(value));
+
+    for (int i = 0; i < 100; ++i) {
+        queue.push(i);
+    }
+    for (int i = 0; i < 100; ++i) {
+        CHECK(queue.pop(value) && value == i);
+    }
+    CHECK(!queue.pop(value));
+
+    // emptied down to the stub and filled again, one at a time (the stub goes back in every time)
+    for (int i = 0; i < 10; ++i) {
+        queue.push(i);
+        CHECK(queue.pop(value) && value == i);
+        CHECK(!queue.pop(value));
+    }
+}
+
+// move-only values, and whatever is left at destruction is freed with the queue
+void testMoveOnlyValues() {
+    MpscQueue<std::unique_ptr<int>> queue;
+    queue.push(std::make_unique<int>(7));
+    queue.push(std::make_unique<int>(8));
+    queue.push(std::make_unique<int>(9));
+
+    std::unique_ptr<int> value;
+    CHECK(queue.pop(value) && value && *value == 7);
+}
+
+// producers push at full speed while the consumer pops: nothing is lost or duplicated and every
+// producer's values come out in the order it pushed them
+void testManyProducers() {
+    const int producerCount = 4;
+    const uint32_t perProducer = 200000;
+    MpscQueue<uint64_t> queue;
+    std::atomic<int> started{0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < producerCount; ++p) {
+        producers.emplace_back([&queue, &started, p, perProducer]() {
+            ++started;
+            while (started.load() < producerCount) {
+            }
+            for (uint32_t i = 0; i < perProducer; ++i) {
+                queue.push((static_cast<uint64_t>(p) << 32) | i);
+            }
+        });
+    }
+
+    std::vector<uint32_t> next(producerCount, 0);
+    uint64_t received = 0;
+    bool ordered = true;
+    uint64_t value = 0;
+    while (received < static_cast<uint64_t>(producerCount) * perProducer) {
+        if (!queue.pop(value)) {
+            // empty, or a producer is between its two steps: the value shows up in a moment
+            std::this_thread::yield();
+            continue;
+        }
+        int producer = static_cast<int>(value >> 32);
+        uint32_t sequence = static_cast<uint32_t>(value);
+        if (producer >= producerCount || sequence != next[producer]) {
+            ordered = false;
+            break;
+        }
+        ++next[producer];
+        ++received;
+    }
+
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    CHECK(ordered);
+    CHECK(received == static_cast<uint64_t>(producerCount) * perProducer);
+    CHECK(!queue.pop(value));
+}
+
+} // namespace
+
+int main() {
+    testFifoOnOneThread();
+    testMoveOnlyValues();
+    testManyProducers();
+    return TEST_RESULT();
+}
@@ -0,0 +1,96 @@
+#include "Check.hpp"
+#include "TestServer.hpp"
+#include "ItemRegistry.hpp"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+// several clients pipelining moves at once against a multi-reactor server: every request gets
+// its answer, on the right connection, and the run reports how many requests per second went through
+int main() {
+    const int clientCount = 8;
+    const int movesPerClient = 2000;
+
+    ItemRegistry::getInstance().initialize();
+
+    ServerConfig config;
+    config.reactorThreads = 2;
+    config.workerThreads = 2;
+    config.heartbeatIntervalMs = 0;
+
+    int port = 0;
+    std::unique_ptr<Server> server = test::startServer(config, port);
+    CHECK(server != nullptr);
+    if (!server) {
+        return TEST_RESULT();
+    }
+
+    std::vector<std::unique_ptr<test::TestClient>> clients;
+    for (int i = 0; i < clientCount; ++i) {
+        auto client = std::make_unique<test::TestClient>(port);
+        CHECK(client->login("player" + std::to_string(i)));
+        CHECK(server->giveItem("player" + std::to_string(i), 1, 5));
+        CHECK(client->receiveType(MessageType::INVENTORY_UPDATE).has_value());
+        clients.push_back(std::move(client));
+    }
+
+    // back and forth between (0,0) and (1,0) of the personal inventory, so every move succeeds
+    std::vector<uint8_t> requests;
+    for (int i = 0; i < movesPerClient; ++i) {
+        NetworkMessage move(MessageType::MOVE_ITEM_REQUEST);
+        uint8_t from = static_cast<uint8_t>(i % 2);
+        move.payload = {0, from, 0, 0, static_cast<uint8_t>(1 - from), 0};
+        std::vector<uint8_t> frame = move.serialize();
+        requests.insert(requests.end(), frame.begin(), frame.end());
+    }
+
+    std::atomic<int> succeeded{0};
+    std::atomic<int> updates{0};
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> threads;
+    for (auto& client : clients) {
+        threads.emplace_back([&, c = client.get()]() {
+            c->sendBytes(requests);
+            int results = 0;
+            while (results < movesPerClient) {
+                std::optional<NetworkMessage> msg = c->receive(5000);
+                if (!msg) {
+                    break;
+                }
+                if (msg->type == MessageType::OPERATION_RESULT) {
+                    ++results;
+                    if (!msg->payload.empty() && msg->payload[0] == 0) {
+                        ++succeeded;
+                    }
+                } else if (msg->type == MessageType::INVENTORY_UPDATE) {
+                    ++updates;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int total = clientCount * movesPerClient;
+    std::cout << total << " moves from " << clientCount << " clients in " << seconds * 1000.0 << " ms ("
+              << static_cast<int>(total / seconds) << " requests/s)" << std::endl;
+
+    CHECK(succeeded == total);
+    CHECK(updates >= total - clientCount); // the last delta may still be on its way
+
+    // every player still has exactly the one stack, wherever the last move left it
+    for (int i = 0; i < clientCount; ++i) {
+        std::optional<InventorySnapshot> snapshot = server->getPlayerInventory("player" + std::to_string(i));
+        CHECK(snapshot && snapshot->items.size() == 1 && snapshot->items[0].stackCount == 5);
+    }
+
+    server->stop();
+    return TEST_RESULT();
+}
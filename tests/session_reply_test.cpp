@@ -0,0 +1,127 @@
+#include "Check.hpp"
+#include "TestServer.hpp"
+#include "InventoryManager.hpp"
+#include "ItemRegistry.hpp"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+bool isConnected(const Server& server, const std::string& username) {
+    std::vector<std::string> players = server.getConnectedPlayers();
+    return std::find(players.begin(), players.end(), username) != players.end();
+}
+
+} // namespace
+
+// a player pipelines moves between their inventory and a stash and hangs up, then reconnects: the
+// server closed the old socket, so the new connection gets the same socket number while the
+// stash's actor is still working through the moves; the new session is the same player, only the
+// session id tells them apart, and none of the old session's answers may reach the new one
+int main() {
+    const int rounds = 20;
+    const int movesPerRound = 3000;
+    const int sortsPerRound = 6000;
+
+    ItemRegistry::getInstance().initialize();
+
+    ServerConfig config;
+    config.reactorThreads = 1;
+    config.workerThreads = 1;
+    config.heartbeatIntervalMs = 0;
+
+    int port = 0;
+    std::unique_ptr<Server> server = test::startServer(config, port);
+    CHECK(server != nullptr);
+    if (!server) {
+        return TEST_RESULT();
+    }
+
+    int foreignFrames = 0;
+    int reused = 0;
+    for (int round = 0; round < rounds; ++round) {
+        std::string player = "player" + std::to_string(round);
+        auto leaver = std::make_unique<test::TestClient>(port);
+        CHECK(leaver->login(player));
+        std::optional<int> leaverSocket = server->getPlayerSocket(player);
+        CHECK(server->giveItem(player, 1, 5));
+        CHECK(leaver->receiveType(MessageType::INVENTORY_UPDATE).has_value());
+
+        // another player keeps the stash's actor busy, so the leaver's moves are still queued there
+        // when the new session is in (the leaver's own strand forwards them faster than the actor runs them)
+        test::TestClient loader(port);
+        CHECK(loader.login("loader" + std::to_string(round)));
+        std::vector<uint8_t> sorts;
+        for (int i = 0; i < sortsPerRound; ++i) {
+            NetworkMessage sort(MessageType::SORT_INVENTORY);
+            sort.payload = {1};
+            std::vector<uint8_t> frame = sort.serialize();
+            sorts.insert(sorts.end(), frame.begin(), frame.end());
+        }
+        CHECK(loader.sendBytes(sorts));
+
+        // (0,0) of the personal inventory to a stash cell of its own this round and back again
+        uint8_t stashX = static_cast<uint8_t>(round % 12);
+        uint8_t stashY = static_cast<uint8_t>(round / 12);
+        std::vector<uint8_t> requests;
+        for (int i = 0; i < movesPerRound; ++i) {
+            NetworkMessage move(MessageType::MOVE_ITEM_REQUEST);
+            if (i % 2 == 0) {
+                move.payload = {0, 0, 0, 1, stashX, stashY};
+            } else {
+                move.payload = {1, stashX, stashY, 0, 0, 0};
+            }
+            std::vector<uint8_t> frame = move.serialize();
+            requests.insert(requests.end(), frame.begin(), frame.end());
+        }
+        CHECK(leaver->sendBytes(requests));
+        leaver->receiveType(MessageType::OPERATION_RESULT);  // the moves are under way
+        leaver->close();
+
+        // gone once the server closed the socket, the lowest free descriptor for the next accept
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (isConnected(*server, player) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(!isConnected(*server, player));
+
+        test::TestClient next(port);
+        CHECK(next.login(player));
+        std::optional<int> nextSocket = server->getPlayerSocket(player);
+        CHECK(leaverSocket && nextSocket);
+        reused += leaverSocket && nextSocket && *leaverSocket == *nextSocket ? 1 : 0;
+
+        // a move out of the stash queues up on its actor behind every move still there from the old
+        // session; it expects a stash version that never exists, so its answer is a STALE_VIEW, which
+        // none of the old session's moves (they expect no version) can get: anything before it is theirs
+        const uint8_t staleView = static_cast<uint8_t>(InventoryManager::OperationResult::STALE_VIEW);
+        CHECK(next.send(MessageType::MOVE_ITEM_REQUEST, {1, 11, 11, 0, 11, 4, 0xFF, 0xFF, 0xFF, 0xFF}));
+        bool answered = false;
+        while (std::optional<NetworkMessage> msg = next.receive(5000)) {
+            if (msg->type == MessageType::OPERATION_RESULT && msg->payload.size() == 1 && msg->payload[0] == staleView) {
+                answered = true;
+                break;
+            }
+            ++foreignFrames;
+            std::cerr << "round " << round << ": new session got message type "
+                      << static_cast<int>(msg->type) << std::endl;
+        }
+        CHECK(answered);
+        while (std::optional<NetworkMessage> msg = next.receive(20)) {
+            ++foreignFrames;
+            std::cerr << "round " << round << ": new session got message type "
+                      << static_cast<int>(msg->type) << " after its own answer" << std::endl;
+        }
+    }
+
+    // every round reconnected on the same socket number, or it tested nothing
+    CHECK(reused == rounds);
+    CHECK(foreignFrames == 0);
+    server->stop();
+    return TEST_RESULT();
+}
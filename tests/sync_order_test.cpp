@@ -0,0 +1,122 @@
+#include "Check.hpp"
+#include "TestServer.hpp"
+#include "ItemRegistry.hpp"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+uint32_t readUint32(const std::vector<uint8_t>& data, size_t offset) {
+    return (static_cast<uint32_t>(data[offset]) << 24) | (static_cast<uint32_t>(data[offset + 1]) << 16) |
+           (static_cast<uint32_t>(data[offset + 2]) << 8) | static_cast<uint32_t>(data[offset + 3]);
+}
+
+} // namespace
+
+// full syncs are serialized outside clientsMutex while the stash keeps changing: a watcher asking
+// for them over and over must never get one older than a delta it already has, and the deltas
+// that follow must always continue from what it holds
+int main() {
+    const int moves = 20000;
+
+    ItemRegistry::getInstance().initialize();
+
+    ServerConfig config;
+    config.reactorThreads = 2;
+    config.workerThreads = 4;
+    config.stashTickMs = 0;  // a delta after every actor batch, as many as possible
+    config.heartbeatIntervalMs = 0;
+
+    int port = 0;
+    std::unique_ptr<Server> server = test::startServer(config, port);
+    CHECK(server != nullptr);
+    if (!server) {
+        return TEST_RESULT();
+    }
+
+    test::TestClient mover(port);
+    test::TestClient watcher(port);
+    CHECK(mover.login("mover"));
+    CHECK(watcher.login("watcher"));
+    CHECK(server->giveItem("mover", 1, 5));
+    CHECK(mover.receiveType(MessageType::INVENTORY_UPDATE).has_value());
+
+    CHECK(watcher.send(MessageType::SUBSCRIBE_STASH, {0}));
+    std::optional<NetworkMessage> first = watcher.receiveType(MessageType::SHARED_STASH_UPDATE);
+    CHECK(first && first->payload.size() >= 7);
+    if (!first || first->payload.size() < 7) {
+        return TEST_RESULT();
+    }
+    uint32_t have = readUint32(first->payload, 3);
+
+    // personal (0,0) to stash 0 (0,0) and back, every move changes the stash
+    std::atomic<bool> moved{false};
+    std::thread moving([&]() {
+        std::vector<uint8_t> requests;
+        for (int i = 0; i < moves; ++i) {
+            NetworkMessage move(MessageType::MOVE_ITEM_REQUEST);
+            move.payload = i % 2 == 0 ? std::vector<uint8_t>{0, 0, 0, 1, 0, 0} : std::vector<uint8_t>{1, 0, 0, 0, 0, 0};
+            std::vector<uint8_t> frame = move.serialize();
+            requests.insert(requests.end(), frame.begin(), frame.end());
+        }
+        mover.sendBytes(requests);
+        for (int results = 0; results < moves;) {
+            std::optional<NetworkMessage> msg = mover.receive(5000);
+            if (!msg) {
+                break;
+            }
+            results += msg->type == MessageType::OPERATION_RESULT ? 1 : 0;
+        }
+        moved = true;
+    });
+
+    int syncs = 0;
+    int deltas = 0;
+    int olderSyncs = 0;
+    int gaps = 0;
+    while (true) {
+        // a resync request with every message while the stash is changing, far more syncs than any
+        // client would ever ask for; once the moves are done, whatever is still on the way
+        bool done = moved;
+        if (!done) {
+            watcher.send(MessageType::SYNC_REQUEST, {1});
+        }
+
+        std::optional<NetworkMessage> msg = watcher.receive(done ? 300 : 20);
+        if (!msg) {
+            if (done) {
+                break;
+            }
+            continue;
+        }
+
+        if (msg->type == MessageType::SHARED_STASH_UPDATE && msg->payload.size() >= 7) {
+            // [stashIndex][width][height][version]...
+            uint32_t version = readUint32(msg->payload, 3);
+            olderSyncs += version < have ? 1 : 0;
+            have = std::max(have, version);
+            ++syncs;
+        } else if (msg->type == MessageType::INVENTORY_UPDATE && msg->payload.size() >= 9 && msg->payload[0] == 1) {
+            // [invType][baseVersion][version]...: applies to anything in [baseVersion, version]
+            uint32_t base = readUint32(msg->payload, 1);
+            uint32_t version = readUint32(msg->payload, 5);
+            gaps += base > have ? 1 : 0;
+            have = std::max(have, version);
+            ++deltas;
+        }
+    }
+    moving.join();
+
+    std::cout << syncs << " full syncs and " << deltas << " deltas, ended at version " << have << std::endl;
+    CHECK(syncs > 50);
+    CHECK(deltas > 0);
+    CHECK(olderSyncs == 0);
+    CHECK(gaps == 0);
+
+    server->stop();
+    return TEST_RESULT();
+}
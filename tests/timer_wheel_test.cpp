@@ -0,0 +1,116 @@
+#include "Check.hpp"
+#include "TimerWheel.hpp"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+void testFiresOnTime() {
+    // delays across all levels, each timer has to fire on exactly its tick
+    TimerWheel wheel;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint64_t> delay(1, 300000);
+
+    std::map<uint64_t, uint64_t> dueByKey;
+    for (uint64_t key = 0; key < 2000; ++key) {
+        uint64_t ticks = key < 64 ? key + 1 : delay(rng); // every slot of the first level, too
+        wheel.schedule(ticks, key);
+        dueByKey[key] = ticks;
+    }
+    CHECK(wheel.pending() == 2000);
+
+    std::vector<TimerWheel::Expiry> expired;
+    size_t fired = 0;
+    for (uint64_t tick = 1; tick <= 300000; ++tick) {
+        expired.clear();
+        wheel.advance(1, expired);
+        for (const auto& expiry : expired) {
+            CHECK(dueByKey[expiry.key] == tick);
+        }
+        fired += expired.size();
+    }
+    CHECK(fired == 2000);
+    CHECK(wheel.pending() == 0);
+}
+
+void testCancel() {
+    TimerWheel wheel;
+    TimerWheel::TimerId soon = wheel.schedule(5, 1);
+    TimerWheel::TimerId later = wheel.schedule(5000, 2);
+    wheel.schedule(10, 3);
+
+    wheel.cancel(soon);
+    wheel.cancel(later);
+    wheel.cancel(later); // twice is harmless
+    CHECK(wheel.pending() == 1);
+
+    std::vector<TimerWheel::Expiry> expired;
+    wheel.advance(6000, expired);
+    CHECK(expired.size() == 1);
+    CHECK(!expired.empty() && expired[0].key == 3);
+}
+
+void testZeroDelayAndBigJumps() {
+    // a delay of 0 still waits one tick, a multi-tick advance catches up on everything due
+    TimerWheel wheel;
+    wheel.schedule(0, 1);
+
+    std::vector<TimerWheel::Expiry> expired;
+    wheel.advance(0, expired);
+    CHECK(expired.empty());
+    wheel.advance(1, expired);
+    CHECK(expired.size() == 1);
+
+    expired.clear();
+    for (uint64_t key = 0; key < 100; ++key) {
+        wheel.schedule(key * 97 + 1, key);
+    }
+    wheel.advance(100 * 97 + 1, expired);
+    CHECK(expired.size() == 100);
+    CHECK(wheel.now() == 1 + 100 * 97 + 1);
+}
+
+void testBeyondRange() {
+    // further out than the 4 levels reach (2^24 ticks), parked and re-sorted until it's due
+    TimerWheel wheel;
+    const uint64_t delay = (uint64_t(1) << 24) + 1000;
+    wheel.schedule(delay, 42);
+
+    std::vector<TimerWheel::Expiry> expired;
+    wheel.advance(delay - 1, expired);
+    CHECK(expired.empty());
+    wheel.advance(1, expired);
+    CHECK(expired.size() == 1);
+}
+
+void testNodeReuse() {
+    // fired and cancelled timers give their slots back, a steady load doesn't grow the wheel
+    TimerWheel wheel;
+    std::vector<TimerWheel::Expiry> expired;
+    TimerWheel::TimerId highest = 0;
+    for (int round = 0; round < 1000; ++round) {
+        TimerWheel::TimerId a = wheel.schedule(3, 0);
+        TimerWheel::TimerId b = wheel.schedule(2, 1);
+        wheel.cancel(a);
+        wheel.advance(2, expired);
+        highest = std::max({highest, a, b});
+    }
+    CHECK(highest < 4);
+    CHECK(expired.size() == 1000);
+    CHECK(wheel.pending() == 0);
+}
+
+} // namespace
+
+int main() {
+    testFiresOnTime();
+    testCancel();
+    testZeroDelayAndBigJumps();
+    testBeyondRange();
+    testNodeReuse();
+    return TEST_RESULT();
+}
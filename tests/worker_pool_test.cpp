@@ -0,0 +1,375 @@
+#include "Check.hpp"
+#include "TestServer.hpp"
+#include "ItemRegistry.hpp"
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace inventory;
+
+namespace {
+
+// polls until done() or a few seconds have passed, false on the timeout
+template <typename Done>
+bool waitFor(Done done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!done()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// keeps a worker busy until released, so whatever is submitted meanwhile stays queued
+class Blocker {
+public:
+    WorkerPool::Task task() {
+        return [this]() {
+            started_ = true;
+            thread_ = std::this_thread::get_id();
+            released_.wait();
+        };
+    }
+
+    void release() { release_.set_value(); }
+    bool started() const { return started_; }
+    std::thread::id thread() const { return thread_; }
+
+private:
+    std::promise<void> release_;
+    std::shared_future<void> released_ = release_.get_future().share();
+    std::atomic<bool> started_{false};
+    std::atomic<std::thread::id> thread_{};
+};
+
+// every poster's tasks run in the order it posted them, strands next to each other don't mix
+void testStrandKeepsPostOrder() {
+    const int strandCount = 4;
+    const int tasksPerStrand = 20000;
+    WorkerPool pool(4);
+    pool.start();
+
+    std::vector<std::shared_ptr<Strand>> strands;
+    std::vector<std::vector<int>> seen(strandCount);
+    std::atomic<int> done{0};
+    for (int s = 0; s < strandCount; ++s) {
+        strands.push_back(std::make_shared<Strand>(pool, s));
+    }
+
+    std::vector<std::thread> posters;
+    for (int s = 0; s < strandCount; ++s) {
+        posters.emplace_back([&, s]() {
+            for (int i = 0; i < tasksPerStrand; ++i) {
+                strands[s]->post([&seen, &done, s, i]() {
+                    seen[s].push_back(i);  // one at a time on the strand, no lock needed
+                    ++done;
+                });
+            }
+        });
+    }
+    for (std::thread& poster : posters) {
+        poster.join();
+    }
+
+    CHECK(waitFor([&]() { return done == strandCount * tasksPerStrand; }));
+    for (int s = 0; s < strandCount; ++s) {
+        bool ordered = static_cast<int>(seen[s].size()) == tasksPerStrand;
+        for (int i = 0; ordered && i < tasksPerStrand; ++i) {
+            ordered = seen[s][i] == i;
+        }
+        CHECK(ordered);
+    }
+    pool.stop();
+}
+
+// however many threads post, a strand's tasks never overlap, and they know they're on it
+void testStrandRunsOneTaskAtATime() {
+    const int posterCount = 4;
+    const int tasksPerPoster = 20000;
+    WorkerPool pool(4);
+    pool.start();
+
+    auto strand = std::make_shared<Strand>(pool, 0);
+    std::atomic<int> inside{0};
+    std::atomic<int> overlaps{0};
+    std::atomic<int> notHere{0};
+    std::atomic<int> done{0};
+
+    std::vector<std::thread> posters;
+    for (int p = 0; p < posterCount; ++p) {
+        posters.emplace_back([&]() {
+            for (int i = 0; i < tasksPerPoster; ++i) {
+                strand->post([&]() {
+                    overlaps += inside.fetch_add(1) != 0 ? 1 : 0;
+                    notHere += strand->runningHere() ? 0 : 1;
+                    inside.fetch_sub(1);
+                    ++done;
+                });
+            }
+        });
+    }
+    for (std::thread& poster : posters) {
+        poster.join();
+    }
+
+    CHECK(waitFor([&]() { return done == posterCount * tasksPerPoster; }));
+    CHECK(overlaps == 0);
+    CHECK(notHere == 0);
+    CHECK(!strand->runningHere());
+    pool.stop();
+}
+
+// tasks still queued when the strand is closed (and any posted after) never run
+void testClosedStrandDropsQueuedTasks() {
+    WorkerPool pool(1);
+    pool.start();
+
+    Blocker blocker;
+    pool.submit(blocker.task(), 0);
+    CHECK(waitFor([&]() { return blocker.started(); }));
+
+    auto strand = std::make_shared<Strand>(pool, 0);
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 100; ++i) {
+        strand->post([&ran]() { ++ran; });
+    }
+    strand->close();
+    strand->post([&ran]() { ++ran; });
+
+    // the only worker takes its own deque in order: the strand's turn comes before this
+    std::atomic<bool> after{false};
+    pool.submit([&after]() { after = true; }, 0);
+    blocker.release();
+
+    CHECK(waitFor([&]() { return after.load(); }));
+    CHECK(ran == 0);
+    pool.stop();
+}
+
+// a task queued behind a busy worker doesn't wait for it, an idle worker steals it
+void testIdleWorkerStealsFromBusyOne() {
+    WorkerPool pool(2);
+    pool.start();
+
+    Blocker blocker;
+    pool.submit(blocker.task(), 0);
+    CHECK(waitFor([&]() { return blocker.started(); }));
+
+    std::atomic<bool> ran{false};
+    std::atomic<std::thread::id> ranOn{};
+    pool.submit([&]() {
+        ranOn = std::this_thread::get_id();
+        ran = true;
+    }, 0);
+
+    CHECK(waitFor([&]() { return ran.load(); }));  // while the blocker still holds its worker
+    CHECK(ranOn.load() != blocker.thread());
+    blocker.release();
+    pool.stop();
+}
+
+// the hook runs on the strand after every batch of at most 64 tasks, once the batch is done
+void testBatchHookRunsAfterEveryBatch() {
+    const int tasks = 200;
+    WorkerPool pool(1);
+    pool.start();
+
+    Blocker blocker;
+    pool.submit(blocker.task(), 0);
+    CHECK(waitFor([&]() { return blocker.started(); }));
+
+    auto strand = std::make_shared<Strand>(pool, 0);
+    int ran = 0;
+    std::vector<int> ranAtHook;
+    std::atomic<bool> hookNotHere{false};
+    std::atomic<int> hooks{0};
+    strand->setBatchHook([&]() {
+        ranAtHook.push_back(ran);
+        hookNotHere = hookNotHere || !strand->runningHere();
+        ++hooks;
+    });
+
+    // all queued before the strand gets its first turn: 64 + 64 + 64 + 8
+    for (int i = 0; i < tasks; ++i) {
+        strand->post([&ran]() { ++ran; });
+    }
+    blocker.release();
+
+    CHECK(waitFor([&]() { return hooks == 4; }));
+    CHECK((ranAtHook == std::vector<int>{64, 128, 192, 200}));
+    CHECK(!hookNotHere);
+    pool.stop();
+}
+
+// stop() runs what is queued, and what those tasks submit, before it returns; a strand works
+// again after a restart, and a task submitted while stopped waits for it
+void testStopFinishesQueuedWorkAndRestarts() {
+    WorkerPool pool(1);
+    pool.start();
+
+    Blocker blocker;
+    pool.submit(blocker.task(), 0);
+    CHECK(waitFor([&]() { return blocker.started(); }));
+
+    auto strand = std::make_shared<Strand>(pool, 0);
+    std::atomic<int> ran{0};
+    for (int i = 0; i < 200; ++i) {
+        strand->post([&ran]() { ++ran; });
+    }
+
+    // a task that only submits the next one, the way a handoff goes from one actor to the other
+    std::atomic<bool> lastStep{false};
+    pool.submit([&]() {
+        pool.submit([&]() {
+            pool.submit([&lastStep]() { lastStep = true; }, 0);
+        }, 0);
+    }, 0);
+
+    // stop() is called while the only worker is still busy, with everything above still queued
+    std::thread stopping([&pool]() { pool.stop(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    blocker.release();
+    stopping.join();
+    CHECK(ran == 200);
+    CHECK(lastStep);
+
+    strand->post([&ran]() { ++ran; });
+    pool.start();
+    CHECK(waitFor([&]() { return ran == 201; }));
+    strand->post([&ran]() { ++ran; });
+    CHECK(waitFor([&]() { return ran == 202; }));
+    pool.stop();
+}
+
+struct StashItem {
+    uint8_t x;
+    uint8_t y;
+    uint32_t stackCount;
+};
+
+// the items of a SHARED_STASH_UPDATE
+std::vector<StashItem> stashItems(const NetworkMessage& msg) {
+    // [stashIndex][width][height][version:4][itemCount:2], then per item [x][y][instanceId:8][itemId:4]
+    // [stackCount:4][nameLength:1][name][width][height][stackLimit:4]
+    std::vector<StashItem> items;
+    const std::vector<uint8_t>& data = msg.payload;
+    if (data.size() < 9) {
+        return items;
+    }
+    size_t count = (static_cast<size_t>(data[7]) << 8) | data[8];
+    size_t offset = 9;
+    for (size_t i = 0; i < count && offset + 19 <= data.size(); ++i) {
+        uint8_t x = data[offset];
+        uint8_t y = data[offset + 1];
+        size_t stack = offset + 14;
+        uint32_t stackCount = (static_cast<uint32_t>(data[stack]) << 24) | (static_cast<uint32_t>(data[stack + 1]) << 16) |
+                              (static_cast<uint32_t>(data[stack + 2]) << 8) | data[stack + 3];
+        items.push_back(StashItem{x, y, stackCount});
+        offset = stack + 4 + 1 + data[stack + 4] + 2 + 4;
+    }
+    return items;
+}
+
+// the server stops while a player is moving a stack between two stashes: every handoff that was
+// under way settles, the stack is still there afterwards, and the stash actors take commands again
+// once the server is back up
+void testServerRestartsMidHandoff() {
+    ItemRegistry::getInstance().initialize();
+
+    ServerConfig config;
+    config.reactorThreads = 1;
+    config.workerThreads = 2;
+    config.heartbeatIntervalMs = 0;
+
+    int port = 0;
+    std::unique_ptr<Server> server = test::startServer(config, port);
+    CHECK(server != nullptr);
+    if (!server) {
+        return;
+    }
+
+    {
+        test::TestClient mover(port);
+        CHECK(mover.login("mover"));
+        CHECK(server->giveItem("mover", 1, 5));
+        CHECK(mover.send(MessageType::MOVE_ITEM_REQUEST, {0, 0, 0, 1, 0, 0}));
+        std::optional<NetworkMessage> placed = mover.receiveType(MessageType::OPERATION_RESULT);
+        CHECK(placed && !placed->payload.empty() && placed->payload[0] == 0);
+
+        // stash 0 (0,0) to stash 1 (0,0) and back, every one a handoff between the two actors
+        std::vector<uint8_t> requests;
+        for (int i = 0; i < 2000; ++i) {
+            NetworkMessage move(MessageType::MOVE_ITEM_REQUEST);
+            move.payload = i % 2 == 0 ? std::vector<uint8_t>{1, 0, 0, 2, 0, 0} : std::vector<uint8_t>{2, 0, 0, 1, 0, 0};
+            std::vector<uint8_t> frame = move.serialize();
+            requests.insert(requests.end(), frame.begin(), frame.end());
+        }
+        CHECK(mover.sendBytes(requests));
+        CHECK(mover.receiveType(MessageType::OPERATION_RESULT).has_value());  // the moves are under way
+        server->stop();
+    }
+
+    server->start();
+    CHECK(server->isRunning());
+    if (!server->isRunning()) {
+        return;
+    }
+
+    test::TestClient mover(port);
+    CHECK(mover.login("mover"));
+
+    uint32_t total = 0;
+    std::optional<InventorySnapshot> personal = server->getPlayerInventory("mover");
+    CHECK(personal.has_value());
+    if (personal) {
+        for (const InventorySlot& slot : personal->items) {
+            total += slot.stackCount;
+        }
+    }
+
+    uint8_t foundIn = 0;  // invType of the stash holding the stack
+    StashItem found{};
+    for (uint8_t stash = 0; stash < 2; ++stash) {
+        CHECK(mover.send(MessageType::SUBSCRIBE_STASH, {stash}));
+        std::optional<NetworkMessage> sync = mover.receiveType(MessageType::SHARED_STASH_UPDATE);
+        CHECK(sync.has_value());
+        if (!sync) {
+            continue;
+        }
+        for (const StashItem& item : stashItems(*sync)) {
+            total += item.stackCount;
+            foundIn = static_cast<uint8_t>(stash + 1);
+            found = item;
+        }
+    }
+    CHECK(total == 5);  // lost if a handoff that lifted it was dropped
+
+    // the actors run commands again: the stack goes back to the personal inventory
+    CHECK(foundIn != 0);
+    if (foundIn != 0) {
+        CHECK(mover.send(MessageType::MOVE_ITEM_REQUEST, {foundIn, found.x, found.y, 0, 0, 0}));
+        std::optional<NetworkMessage> result = mover.receiveType(MessageType::OPERATION_RESULT);
+        CHECK(result && !result->payload.empty() && result->payload[0] == 0);
+    }
+
+    server->stop();
+}
+
+} // namespace
+
+int main() {
+    testStrandKeepsPostOrder();
+    testStrandRunsOneTaskAtATime();
+    testClosedStrandDropsQueuedTasks();
+    testIdleWorkerStealsFromBusyOne();
+    testBatchHookRunsAfterEveryBatch();
+    testStopFinishesQueuedWorkAndRestarts();
+    testServerRestartsMidHandoff();
+    return TEST_RESULT();
+}